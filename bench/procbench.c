@@ -0,0 +1,358 @@
+/**
+ * @file  procbench.c
+ * @brief Process Manager Benchmark
+ *
+ * Measures the throughput and latency of process_create, process_open and
+ *   process_close/process_free across engines, argv/envp sizes and parent
+ *   resident set sizes, and prints one JSON object per configuration
+ *
+ * Build from the repository root (or run make procbench):
+ *   cc -O2 -std=c99 -o procbench bench/procbench.c procmanage.c -pthread
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#elif defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "../procmanage.h"
+
+// Phases timed for every launch
+#define BENCH_PHASE_CREATE 0 // process_create
+#define BENCH_PHASE_OPEN   1 // process_open
+#define BENCH_PHASE_WAIT   2 // process_wait (the child runs and exits)
+#define BENCH_PHASE_CLOSE  3 // process_close and process_free
+#define BENCH_PHASES       4
+
+// The most values accepted by a sweep option
+#define BENCH_SWEEP_MAX 16
+
+// Names of the phases in the JSON output
+static const char* bench_phase_names[BENCH_PHASES] = {
+  "create", "open", "wait", "close"
+};
+
+// A list of values to sweep over
+struct BenchSweep {
+  long   values[BENCH_SWEEP_MAX]; // the values
+  size_t count;                   // number of values
+};
+
+// Settings of a benchmark run
+struct BenchConfig {
+  const char*       binary;  // binary launched by every iteration
+  size_t            iters;   // launches per configuration
+  struct BenchSweep engines; // engines (PROCESS_ENGINE_*)
+  struct BenchSweep argcs;   // argument counts
+  struct BenchSweep envcs;   // environment variable counts
+  struct BenchSweep rss;     // parent heap pre-faulted before launching (MB)
+};
+
+/**
+ * @brief Bench Compare
+ *
+ * Orders two latencies for qsort
+ *
+ * @param a The first latency
+ * @param b The second latency
+ *
+ * @return <0, 0 or >0
+ */
+static int bench_compare(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Bench Engine Name
+ *
+ * Names a launch engine
+ *
+ * @param engine The engine (one of PROCESS_ENGINE_*)
+ *
+ * @return The name of the engine
+ */
+static const char* bench_engine_name(long engine) {
+  switch (engine) {
+    case PROCESS_ENGINE_SPAWN:
+      return "spawn";
+    case PROCESS_ENGINE_VFORK:
+      return "vfork";
+    case PROCESS_ENGINE_ZYGOTE:
+      return "zygote";
+  }
+  return "fork";
+}
+
+/**
+ * @brief Bench Now
+ *
+ * Gets the current monotonic time
+ *
+ * @return The current monotonic time in nanoseconds
+ */
+static int64_t bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Bench Parse Sweep
+ *
+ * Parses a comma-separated list of numbers or engine names
+ *
+ * @param[out] sweep The parsed values
+ * @param      list  The list
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+static int bench_parse_sweep(struct BenchSweep* sweep, const char* list) {
+  sweep->count = 0;
+  while (*list != '\0' && sweep->count < BENCH_SWEEP_MAX) {
+    size_t len = strcspn(list, ",");
+    long value = -1;
+    const char* names[] = { "fork", "spawn", "vfork", "zygote" };
+    for (int i = 0; i < 4; i++) {
+      if (strlen(names[i]) == len && strncmp(list, names[i], len) == 0) {
+        value = PROCESS_ENGINE_FORK + i;
+      }
+    }
+    if (value == -1) {
+      char* end;
+      value = strtol(list, &end, 10);
+      if (end != list + len || value < 0) {
+        return 0;
+      }
+    }
+    sweep->values[sweep->count++] = value;
+    list += len + (list[len] == ',' ? 1 : 0);
+  }
+  return (sweep->count > 0 ? 1 : 0);
+}
+
+/**
+ * @brief Bench Report
+ *
+ * Prints the results of one configuration as a JSON object
+ *
+ * @param cfg       The benchmark settings
+ * @param engine    The engine used
+ * @param argc      The argument count used
+ * @param envc      The environment variable count used
+ * @param rss       The parent heap pre-faulted (MB)
+ * @param lat       The latencies of each phase (sorted in place)
+ * @param n         The number of successful launches
+ * @param elapsed   The wall time of the whole configuration (ns)
+ */
+static void bench_report(const struct BenchConfig* cfg, long engine,
+    long argc, long envc, long rss, int64_t* lat[BENCH_PHASES], size_t n,
+    int64_t elapsed) {
+  printf("{\"binary\":\"%s\",\"engine\":\"%s\",\"argc\":%ld,\"envc\":%ld,"
+    "\"rss_mb\":%ld,\"iters\":%zu,\"launched\":%zu,\"per_sec\":%.1f",
+    cfg->binary, bench_engine_name(engine), argc, envc, rss, cfg->iters, n,
+    (elapsed > 0 ? (double)n * 1e9 / (double)elapsed : 0.0));
+  for (int phase = 0; phase < BENCH_PHASES; phase++) {
+    int64_t sum = 0;
+    qsort(lat[phase], n, sizeof(int64_t), bench_compare);
+    for (size_t i = 0; i < n; i++) {
+      sum += lat[phase][i];
+    }
+    int64_t p50 = (n > 0 ? lat[phase][n / 2] : 0);
+    int64_t p99 = (n > 0 ? lat[phase][(n * 99) / 100] : 0);
+    printf(",\"%s\":{\"mean_us\":%.2f,\"p50_us\":%.2f,\"p99_us\":%.2f}",
+      bench_phase_names[phase], (n > 0 ? (double)sum / (double)n / 1e3 : 0.0),
+      (double)p50 / 1e3, (double)p99 / 1e3);
+  }
+  printf("}\n");
+  fflush(stdout);
+}
+
+/**
+ * @brief Bench Run
+ *
+ * Launches the binary cfg->iters times with one configuration and reports
+ *   the results
+ *
+ * @param cfg    The benchmark settings
+ * @param engine The engine to use
+ * @param argc   The number of arguments to pass
+ * @param envc   The number of environment variables to pass
+ * @param rss    The parent heap pre-faulted (MB), for the report
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+static int bench_run(const struct BenchConfig* cfg, long engine, long argc,
+    long envc, long rss) {
+  // Build the argument and environment lists
+  char** argv = calloc((size_t)argc + 2, sizeof(char*));
+  char** envp = calloc((size_t)envc + 1, sizeof(char*));
+  char*  strs = malloc(((size_t)argc + (size_t)envc) * 32 + 1);
+  int64_t* lat[BENCH_PHASES];
+  for (int phase = 0; phase < BENCH_PHASES; phase++) {
+    lat[phase] = malloc(cfg->iters * sizeof(int64_t));
+  }
+  int ok = (argv != NULL && envp != NULL && strs != NULL);
+  for (int phase = 0; phase < BENCH_PHASES; phase++) {
+    ok = ok && lat[phase] != NULL;
+  }
+  if (ok) {
+    char* pos = strs;
+    argv[0] = (char*)cfg->binary;
+    for (long i = 0; i < argc; i++) {
+      argv[i + 1] = pos;
+      pos += sprintf(pos, "argument-%ld", i) + 1;
+    }
+    for (long i = 0; i < envc; i++) {
+      envp[i] = pos;
+      pos += sprintf(pos, "BENCH_VARIABLE_%ld=value", i) + 1;
+    }
+
+    // Launch, wait for and close the binary, timing each phase
+    size_t n = 0;
+    int64_t start = bench_now();
+    for (size_t i = 0; i < cfg->iters; i++) {
+      int64_t t0 = bench_now();
+      struct Process* p = process_create(cfg->binary, argv, envp);
+      process_set_engine(p, (int)engine);
+      int64_t t1 = bench_now();
+      int opened = process_open(p);
+      int64_t t2 = bench_now();
+      if (opened) {
+        process_wait(p);
+      }
+      int64_t t3 = bench_now();
+      process_close(p);
+      process_free(p);
+      int64_t t4 = bench_now();
+      if (opened) {
+        lat[BENCH_PHASE_CREATE][n] = t1 - t0;
+        lat[BENCH_PHASE_OPEN][n]   = t2 - t1;
+        lat[BENCH_PHASE_WAIT][n]   = t3 - t2;
+        lat[BENCH_PHASE_CLOSE][n]  = t4 - t3;
+        n++;
+      }
+    }
+    bench_report(cfg, engine, argc, envc, rss, lat, n, bench_now() - start);
+  }
+
+  for (int phase = 0; phase < BENCH_PHASES; phase++) {
+    free(lat[phase]);
+  }
+  free(argv);
+  free(envp);
+  free(strs);
+  return ok;
+}
+
+/**
+ * @brief Bench Usage
+ *
+ * Prints the command line options
+ *
+ * @param name The name of the program
+ */
+static void bench_usage(const char* name) {
+  fprintf(stderr,
+    "usage: %s [-b binary] [-n iterations] [-e engines] [-a argcs]\n"
+    "       [-v envcs] [-r rss_mb]\n"
+    "  -b  binary to launch (default /bin/true)\n"
+    "  -n  launches per configuration (default 200)\n"
+    "  -e  engines: fork,spawn,vfork,zygote (default fork,spawn,vfork)\n"
+    "  -a  argument counts (default 1,64,1024)\n"
+    "  -v  environment variable counts (default 0,64,1024)\n"
+    "  -r  parent heap to pre-fault, in MB (default 0,256)\n", name);
+}
+
+int main(int argc, char* argv[]) {
+  struct BenchConfig cfg;
+  cfg.binary = "/bin/true";
+  cfg.iters  = 200;
+  bench_parse_sweep(&cfg.engines, "fork,spawn,vfork");
+  bench_parse_sweep(&cfg.argcs, "1,64,1024");
+  bench_parse_sweep(&cfg.envcs, "0,64,1024");
+  bench_parse_sweep(&cfg.rss, "0,256");
+
+  // Parse the command line
+  for (int i = 1; i < argc; i++) {
+    const char* value = (i + 1 < argc ? argv[i + 1] : NULL);
+    int ok = (value != NULL && argv[i][0] == '-' &&
+      argv[i][1] != '\0' && argv[i][2] == '\0');
+    if (ok) {
+      switch (argv[i][1]) {
+        case 'b':
+          cfg.binary = value;
+          break;
+        case 'n':
+          cfg.iters = (size_t)strtoul(value, NULL, 10);
+          ok = (cfg.iters > 0);
+          break;
+        case 'e':
+          ok = bench_parse_sweep(&cfg.engines, value);
+          break;
+        case 'a':
+          ok = bench_parse_sweep(&cfg.argcs, value);
+          break;
+        case 'v':
+          ok = bench_parse_sweep(&cfg.envcs, value);
+          break;
+        case 'r':
+          ok = bench_parse_sweep(&cfg.rss, value);
+          break;
+        default:
+          ok = 0;
+          break;
+      }
+    }
+    if (!ok) {
+      bench_usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+
+  // Start the zygote while the parent is still small
+  for (size_t e = 0; e < cfg.engines.count; e++) {
+    if (cfg.engines.values[e] == PROCESS_ENGINE_ZYGOTE &&
+        !process_zygote_start()) {
+      fprintf(stderr, "failed to start the zygote\n");
+      return 1;
+    }
+  }
+
+  // Sweep every configuration
+  int retVal = 0;
+  for (size_t r = 0; r < cfg.rss.count; r++) {
+    size_t size = (size_t)cfg.rss.values[r] << 20;
+    char* heap = NULL;
+    if (size > 0) {
+      heap = malloc(size);
+      if (heap == NULL) {
+        fprintf(stderr, "failed to allocate %ld MB\n", cfg.rss.values[r]);
+        retVal = 1;
+        break;
+      }
+      // Touch every page so the heap is resident
+      for (size_t off = 0; off < size; off += 4096) {
+        ((volatile char*)heap)[off] = 1;
+      }
+    }
+    for (size_t e = 0; e < cfg.engines.count; e++) {
+      for (size_t a = 0; a < cfg.argcs.count; a++) {
+        for (size_t v = 0; v < cfg.envcs.count; v++) {
+          if (!bench_run(&cfg, cfg.engines.values[e], cfg.argcs.values[a],
+                cfg.envcs.values[v], cfg.rss.values[r])) {
+            retVal = 1;
+          }
+        }
+      }
+    }
+    free(heap);
+  }
+
+  process_zygote_stop();
+  return retVal;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file  threadstress.c
+ * @brief Process Manager Thread Stress Test
+ *
+ * Launches children from many threads at once, mixing every engine with
+ *   ProcessPool leases, a shared environment template and statistics reads,
+ *   checks that every child saw the environment it was given, and prints one
+ *   JSON object with the results
+ *
+ * Build from the repository root (or run make threadstress):
+ *   cc -O2 -std=c99 -o threadstress bench/threadstress.c procmanage.c -pthread
+ *
+ * Build with ThreadSanitizer to check for data races:
+ *   cc -g -O1 -std=c99 -fsanitize=thread -o threadstress \
+ *     bench/threadstress.c procmanage.c -pthread
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#elif defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "../procmanage.h"
+
+// The most engines accepted by -e
+#define STRESS_ENGINES_MAX 4
+
+// References taken and dropped on the shared template per launch
+#define STRESS_REFS 16
+
+// Settings of a stress run
+struct StressConfig {
+  size_t threads;                    // launching threads
+  size_t iters;                      // launches per thread
+  int    engines[STRESS_ENGINES_MAX]; // engines (PROCESS_ENGINE_*)
+  size_t engine_count;               // number of engines
+  struct ProcessEnvTemplate* env;    // environment shared by every launch
+  struct ProcessPool*        pool;   // pool of cat workers (one per thread
+                                     //   at most) shared by every thread
+};
+
+// Results of one thread
+struct StressThread {
+  const struct StressConfig* cfg; // the stress settings
+  pthread_t thread;   // the thread
+  size_t index;       // index of the thread
+  size_t launched;    // children launched and reaped
+  size_t failed;      // children that failed to launch or exited with an
+                      //   error
+  size_t leases;      // pool workers leased and echoed through
+  size_t lease_failed; // pool leases that failed or didn't echo
+};
+
+/**
+ * @brief Stress Lease
+ *
+ * Leases a worker from the shared pool and checks that it echoes a line
+ *
+ * @param cfg The stress settings
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+static int stress_lease(const struct StressConfig* cfg) {
+  struct Process* p = process_pool_acquire(cfg->pool);
+  if (p == NULL) {
+    return 0;
+  }
+  char buf[2];
+  size_t done = 0;
+  int ok = (write(p->in, "x\n", 2) == 2);
+  while (ok && done < sizeof(buf)) {
+    ssize_t count = read(p->out, buf + done, sizeof(buf) - done);
+    if (count <= 0) {
+      ok = 0;
+    }
+    else {
+      done += (size_t)count;
+    }
+  }
+  process_pool_release(cfg->pool, p);
+  return (ok && memcmp(buf, "x\n", 2) == 0);
+}
+
+/**
+ * @brief Stress Main
+ *
+ * Body of a launching thread
+ *
+ * @param arg The thread's results
+ *
+ * @return NULL
+ */
+static void* stress_main(void* arg) {
+  struct StressThread* t = arg;
+  const struct StressConfig* cfg = t->cfg;
+
+  // Every child checks the shared variable and its own launch's variable
+  char own[64];
+  char script[128];
+  snprintf(own, sizeof(own), "%zu", t->index);
+  snprintf(script, sizeof(script),
+    "test \"$STRESS_SHARED\" = shared && test \"$STRESS_OWN\" = %zu",
+    t->index);
+  char* argv[] = { "sh", "-c", script, NULL };
+
+  for (size_t i = 0; i < cfg->iters; i++) {
+    // Churn the shared template's reference count
+    for (int r = 0; r < STRESS_REFS; r++) {
+      process_env_template_retain(cfg->env);
+    }
+    for (int r = 0; r < STRESS_REFS; r++) {
+      process_env_template_release(cfg->env);
+    }
+
+    // Launch and reap a child
+    int engine = cfg->engines[(t->index + i) % cfg->engine_count];
+    struct Process* p = process_create("/bin/sh", argv, NULL);
+    int ok = (p != NULL);
+    if (ok) {
+      process_set_engine(p, engine);
+      process_set_env_template(p, cfg->env);
+      process_set_env(p, "STRESS_OWN", own);
+      ok = process_open(p);
+    }
+    if (ok) {
+      process_wait(p);
+      ok = (p->status != -1 && WIFEXITED(p->status) &&
+        WEXITSTATUS(p->status) == 0);
+      t->launched++;
+    }
+    if (!ok) {
+      t->failed++;
+    }
+    if (p != NULL) {
+      process_close(p);
+      process_free(p);
+    }
+
+    // Lease a pool worker, and read the statistics, now and then
+    if (i % 4 == 0) {
+      if (stress_lease(cfg)) {
+        t->leases++;
+      }
+      else {
+        t->lease_failed++;
+      }
+    }
+    if (i % 16 == 0) {
+      struct ProcessStats stats;
+      process_get_stats(&stats);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Stress Now
+ *
+ * Gets the current monotonic time
+ *
+ * @return The current monotonic time in nanoseconds
+ */
+static int64_t stress_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Stress Parse Engines
+ *
+ * Parses a comma-separated list of engine names
+ *
+ * @param[out] cfg  The stress settings
+ * @param      list The list
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+static int stress_parse_engines(struct StressConfig* cfg, const char* list) {
+  const char* names[] = { "fork", "spawn", "vfork", "zygote" };
+  cfg->engine_count = 0;
+  while (*list != '\0') {
+    size_t len = strcspn(list, ",");
+    int engine = -1;
+    for (int i = 0; i < 4; i++) {
+      if (strlen(names[i]) == len && strncmp(list, names[i], len) == 0) {
+        engine = PROCESS_ENGINE_FORK + i;
+      }
+    }
+    if (engine == -1 || cfg->engine_count == STRESS_ENGINES_MAX) {
+      return 0;
+    }
+    cfg->engines[cfg->engine_count++] = engine;
+    list += len + (list[len] == ',' ? 1 : 0);
+  }
+  return (cfg->engine_count > 0 ? 1 : 0);
+}
+
+/**
+ * @brief Stress Usage
+ *
+ * Prints the command line options
+ *
+ * @param name The name of the program
+ */
+static void stress_usage(const char* name) {
+  fprintf(stderr,
+    "usage: %s [-t threads] [-n iterations] [-e engines]\n"
+    "  -t  launching threads (default 32)\n"
+    "  -n  launches per thread (default 200)\n"
+    "  -e  engines: fork,spawn,vfork,zygote (default all of them)\n", name);
+}
+
+int main(int argc, char* argv[]) {
+  struct StressConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.threads = 32;
+  cfg.iters   = 200;
+  stress_parse_engines(&cfg, "fork,spawn,vfork,zygote");
+
+  // Parse the command line
+  for (int i = 1; i < argc; i++) {
+    const char* value = (i + 1 < argc ? argv[i + 1] : NULL);
+    int ok = (value != NULL && argv[i][0] == '-' &&
+      argv[i][1] != '\0' && argv[i][2] == '\0');
+    if (ok) {
+      switch (argv[i][1]) {
+        case 't':
+          cfg.threads = (size_t)strtoul(value, NULL, 10);
+          ok = (cfg.threads > 0);
+          break;
+        case 'n':
+          cfg.iters = (size_t)strtoul(value, NULL, 10);
+          ok = (cfg.iters > 0);
+          break;
+        case 'e':
+          ok = stress_parse_engines(&cfg, value);
+          break;
+        default:
+          ok = 0;
+          break;
+      }
+    }
+    if (!ok) {
+      stress_usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+
+  // Start the zygote before any thread exists, since it forks the caller
+  for (size_t e = 0; e < cfg.engine_count; e++) {
+    if (cfg.engines[e] == PROCESS_ENGINE_ZYGOTE && !process_zygote_start()) {
+      fprintf(stderr, "failed to start the zygote\n");
+      return 1;
+    }
+  }
+
+  // Create the state shared by every thread
+  char* envs[] = { "STRESS_SHARED=shared", "PATH=/bin:/usr/bin", NULL };
+  char* cat_argv[] = { "cat", NULL };
+  cfg.env  = process_env_template_create(envs);
+  cfg.pool = process_pool_create("/bin/cat", cat_argv, NULL, 2, cfg.threads);
+  struct StressThread* threads = calloc(cfg.threads,
+    sizeof(struct StressThread));
+  if (cfg.env == NULL || cfg.pool == NULL || threads == NULL) {
+    fprintf(stderr, "failed to set up the shared state\n");
+    return 1;
+  }
+
+  // Run every thread
+  int64_t start = stress_now();
+  size_t started = 0;
+  for (; started < cfg.threads; started++) {
+    threads[started].cfg   = &cfg;
+    threads[started].index = started;
+    if (pthread_create(&threads[started].thread, NULL, stress_main,
+          &threads[started]) != 0) {
+      fprintf(stderr, "failed to start thread %zu\n", started);
+      break;
+    }
+  }
+  struct StressThread total;
+  memset(&total, 0, sizeof(total));
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(threads[i].thread, NULL);
+    total.launched     += threads[i].launched;
+    total.failed       += threads[i].failed;
+    total.leases       += threads[i].leases;
+    total.lease_failed += threads[i].lease_failed;
+  }
+  int64_t elapsed = stress_now() - start;
+
+  // Report the results
+  struct ProcessStats stats;
+  process_get_stats(&stats);
+  printf("{\"threads\":%zu,\"iters\":%zu,\"launched\":%zu,\"failed\":%zu,"
+    "\"leases\":%zu,\"lease_failed\":%zu,\"spawns\":%llu,\"per_sec\":%.1f}\n",
+    started, cfg.iters, total.launched, total.failed, total.leases,
+    total.lease_failed, (unsigned long long)stats.spawns,
+    (elapsed > 0 ? (double)total.launched * 1e9 / (double)elapsed : 0.0));
+
+  process_pool_free(cfg.pool);
+  process_env_template_release(cfg.env);
+  process_zygote_stop();
+  free(threads);
+  return (started == cfg.threads && total.failed == 0 &&
+    total.lease_failed == 0 ? 0 : 1);
+}
@@ -12,14 +12,607 @@
 #ifndef _PROCMANAGE_C
 #define _PROCMANAGE_C
 
+#if defined(__linux__)
+#define _GNU_SOURCE
+#elif defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
 #define _POSIX_SOURCE
+#endif
 #include "procmanage.h"
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+#ifndef CLONE_PIDFD
+#define CLONE_PIDFD 0x1000
+#endif
+#ifndef CLONE_INTO_CGROUP
+#define CLONE_INTO_CGROUP 0x200000000ULL
+#endif
+
+// Declare internal types
+struct ProcessWatchStream;
+struct ProcessZygoteReply;
 
 // Declare internal function prototypes
+char* _process_arena_alloc(struct ProcessArena* arena, size_t len);
+void _process_arena_clear(struct ProcessArena* arena);
+void _process_arena_reset(struct ProcessArena* arena);
+int _process_array_append(char*** arr, size_t* count, size_t* cap,
+  char* item);
 int _process_array_count(char* const arr[]);
-void _process_array_clear(char*** arr);
-void _process_array_push(char*** arr, const char* item);
+void _process_array_clear(char*** arr, size_t* count, size_t* cap,
+  struct ProcessArena* arena);
+void _process_array_push(char*** arr, size_t* count, size_t* cap,
+  struct ProcessArena* arena, const char* item);
+int _process_array_reserve(char*** arr, size_t* cap, size_t n);
+void _process_array_reset(char** arr, size_t* count,
+  struct ProcessArena* arena);
+struct ProcessCache* _process_cache(int create);
+void _process_cache_exit(void* cache);
+void _process_cache_init(void);
+ssize_t _process_capture(struct Process* p, int stream);
+void _process_capture_rotate(struct ProcessCapture* c);
+void _process_child_cgroup(struct Process* p, int report);
+void _process_child_exec(struct Process* p, const int child[3],
+  const int parent[3], int report);
+void _process_child_fail(int report);
+void _process_child_fds(struct Process* p);
+void _process_destroy(struct Process* p);
+int _process_engine(struct Process* p);
+int _process_escalate(struct Process* p, int64_t now);
+int _process_env_flatten(struct Process* p);
+size_t _process_env_hash(const char* name, size_t len);
+void _process_env_index_clear(struct ProcessEnvIndex* ix);
+struct ProcessEnvSlot* _process_env_index_find(struct ProcessEnvIndex* ix,
+  const char* name, size_t len);
+struct ProcessEnvSlot* _process_env_index_insert(struct ProcessEnvIndex* ix,
+  const char* name, size_t len, size_t index);
+void _process_env_index_remove(struct ProcessEnvIndex* ix,
+  struct ProcessEnvSlot* slot);
+void _process_env_index_reset(struct ProcessEnvIndex* ix);
+int _process_env_name_equal(const char* a, const char* b);
+void _process_env_put(char*** arr, size_t* count, size_t* cap,
+  struct ProcessEnvIndex* ix, char* env);
+void _process_env_template_drop(struct ProcessEnvTemplate* t);
+char** _process_environ(struct Process* p);
+pid_t _process_exec_wait(struct Process* p, pid_t pid, const int report[2]);
+void _process_fds_sweep(int first, int close_them);
+void _process_feed_drop(struct Process* p);
+ssize_t _process_feed_flush(struct Process* p);
+struct ProcessFeed* _process_feed_get(struct Process* p);
+int _process_feed_push(struct Process* p, const void* base, size_t len,
+  void* owned, size_t spare, ProcessFeedCallback callback, void* data);
+void _process_feed_watch(struct Process* p);
+int _process_group_register(struct ProcessGroup* g,
+  struct ProcessWatchStream* ws, int enable);
+void _process_group_deadlines(struct ProcessGroup* g, int64_t now);
+int _process_group_drain(struct ProcessGroup* g, struct ProcessWatchStream* ws,
+  int events);
+int _process_launch(struct Process* p, const int child[3],
+  const int parent[3]);
+char* _process_lookup(const char* name, const char* search);
+size_t _process_lookup_dirs(const char* search, size_t max, int64_t mtimes[]);
+char* _process_lookup_walk(const char* name, const char* search,
+  size_t* dirs);
+int64_t _process_mtime(const char* dir, size_t len);
+int64_t _process_now(void);
+int64_t _process_now_us(void);
+int _process_node_cpus(int node, int cpus[], int max);
+int _process_null_fd(void);
+int _process_path_set(struct Process* p, const char* path);
+int _process_pidfd(struct Process* p);
+int _process_pipe(int fds[2]);
+int _process_pipes_open(struct Process* p, int child[3], int parent[3]);
+int _process_placement_apply(const struct ProcessPlacement* pl);
+struct ProcessPlacement* _process_placement_get(struct Process* p);
+size_t _process_pool_spawn(struct ProcessPool* pool, size_t n);
+int _process_pty_open(struct Process* p, int child[3], int parent[3]);
+int _process_read_full(int fd, void* buf, size_t len);
+int _process_reap(struct Process* p, int block);
+void _process_reset(struct Process* p);
+void _process_service_detach(struct ProcessService* svc);
+void _process_service_exit(struct Process* p, void* data);
+void _process_service_queue(struct ProcessService* svc, int64_t due);
+int _process_service_retry(struct ProcessService* svc, int64_t now);
+void _process_service_unqueue(struct ProcessService* svc);
+int _process_signal(struct Process* p, int sig);
+struct ProcessSlab* _process_slab_get(struct ProcessGroup* g);
+pid_t _process_spawn(struct Process* p, const int child[3],
+  const int parent[3]);
+pid_t _process_spawn_clone3(struct Process* p, const int child[3],
+  const int parent[3], int report);
+pid_t _process_spawn_fork(struct Process* p, const int child[3],
+  const int parent[3], int report);
+pid_t _process_spawn_posix(struct Process* p, const int child[3],
+  const int parent[3]);
+pid_t _process_spawn_vfork(struct Process* p, const int child[3],
+  const int parent[3], int report);
+pid_t _process_spawn_zygote(struct Process* p, const int child[3],
+  const int parent[3]);
+struct ProcessStats* _process_stats(void);
+void _process_stats_exit(void* slot);
+void _process_stats_init(void);
+void _process_stats_merge(struct ProcessStats* dst,
+  struct ProcessStats* src);
+void _process_stats_total(struct ProcessStats* total);
+int _process_stdio_mode(struct Process* p, int stream);
+int _process_stream_fd(struct Process* p, int stream);
 void _process_string_copy(char** dest, const char* src);
+void _process_supervisor_advance(struct ProcessSupervisor* s, int64_t now);
+int _process_supervisor_timeout(struct ProcessSupervisor* s, int timeout);
+void _process_trace(struct Process* p, int phase, int end);
+void _process_wait_exit(struct Process* p, int timeout);
+void _process_watch_remove(struct ProcessWatch* w);
+void _process_watch_stream_remove(struct ProcessWatchStream* ws);
+int _process_write_full(int fd, const void* buf, size_t len);
+void _process_zygote_main(int fd);
+void _process_zygote_reap(void);
+int _process_zygote_receive(int fd, struct ProcessZygoteReply* reply,
+  int fds[2]);
+int _process_zygote_send(int fd, const struct ProcessZygoteReply* reply,
+  const int fds[2]);
+int _process_zygote_serve(int fd);
+void _process_zygote_sigchld(int sig);
+int _process_zygote_track(pid_t pid);
+
+// The size of the buffer used to list /proc/self/fd in the child
+#define _PROCESS_FDS_BUFFER 4096
+
+// The highest fd limit the child's last-resort loop over every possible fd
+//   honors (Linux's default nr_open); fds past it aren't covered there
+#define _PROCESS_FDS_MAX 1048576
+
+// The most CPUs and NUMA nodes a ProcessPlacement can name
+#define _PROCESS_PLACE_CPUS  1024
+#define _PROCESS_PLACE_NODES 1024
+
+// CPU affinity and NUMA memory policy applied in the child before it execs
+struct ProcessPlacement {
+  int           has_cpus;  // whether cpus was set
+  int           numa_mode; // NUMA policy (one of PROCESS_NUMA_*)
+  unsigned char cpus[_PROCESS_PLACE_CPUS / 8];   // CPU mask
+  unsigned long nodes[_PROCESS_PLACE_NODES / (8 * sizeof(unsigned long))];
+};
+
+// Pipe ends of one Process launched by process_open_batch
+struct ProcessBatchSlot {
+  int child[3];  // the ends that become the child's stdin, stdout and stderr
+  int parent[3]; // the ends kept by the parent
+  int ready;     // whether the pipes were opened
+};
+
+// The smallest block allocated by a ProcessArena
+#define _PROCESS_ARENA_MIN 512
+
+// Block of string storage owned by a ProcessArena
+struct ProcessArenaBlock {
+  struct ProcessArenaBlock* next; // previously allocated (smaller) block
+  size_t size;                    // bytes of storage in data
+  size_t used;                    // bytes of storage in use
+  char   data[];                  // the storage
+};
+
+// The smallest buffer allocated for PROCESS_CAPTURE_FULL
+#define _PROCESS_CAPTURE_MIN 4096
+
+// The smallest buffer allocated to copy bytes queued by process_feed (small
+//   writes are coalesced into it)
+#define _PROCESS_FEED_CHUNK 16384
+
+// The most buffers written by one writev of the stdin feeder
+#define _PROCESS_FEED_IOVS 64
+
+// Buffer queued for a Process' stdin
+struct ProcessFeedEntry {
+  struct iovec        iov;      // the bytes left to write
+  void*               owned;    // storage copied by process_feed (or NULL)
+  size_t              spare;    // unused bytes of owned after the queued ones
+  ProcessFeedCallback callback; // called once the buffer is done (or NULL)
+  void*               data;     // user data passed to the callback
+};
+
+// Queue of buffers written to a Process' stdin as the pipe drains
+struct ProcessFeed {
+  struct ProcessFeedEntry* entries; // ring of queued buffers
+  size_t head;    // position of the oldest buffer in entries
+  size_t count;   // number of queued buffers
+  size_t cap;     // number of entries allocated (a power of two)
+  size_t pending; // number of bytes queued
+  int    closing; // close stdin once every buffer has been written
+};
+
+// The most bytes moved by one call to process_forward_output
+#define _PROCESS_FORWARD_CHUNK (1 << 20)
+
+// The size of the bounce buffer used where splice isn't available
+#define _PROCESS_FORWARD_BUFFER 65536
+
+// The maximum number of events dispatched per call to process_group_poll
+#define _PROCESS_GROUP_EVENTS 256
+
+// The size of each buffer of a ProcessGroup's slab pool, and the most
+//   buffers filled by one readv of a drained stream
+#define _PROCESS_SLAB_SIZE 16384
+#define _PROCESS_SLAB_IOVS 8
+
+// Buffer of a ProcessGroup's slab pool
+struct ProcessSlab {
+  struct ProcessSlab* next; // next free buffer in the pool
+  char data[_PROCESS_SLAB_SIZE]; // the buffer
+};
+
+// How often (in milliseconds) a ProcessGroup polls for exits that it can't
+//   watch with a pidfd (Linux before 5.3)
+#define _PROCESS_GROUP_SWEEP 50
+
+// Pseudo-stream of a ProcessWatch used to watch for the Process' exit
+#define _PROCESS_STREAM_EXIT 3
+
+// A watched stream of a Process (referenced by the kernel event)
+struct ProcessWatchStream {
+  struct ProcessWatch* watch;  // the watch this stream belongs to
+  int                  stream; // one of PROCESS_STREAM_* or _STREAM_EXIT
+  int                  fd;     // the registered fd (pidfd or pid for the
+                               //   exit stream), or -1
+};
+
+// Registration of a Process in a ProcessGroup
+struct ProcessWatch {
+  struct ProcessGroup*      group;      // the group watching the Process
+  struct Process*           p;          // the watched Process
+  ProcessEventCallback      callback;   // readiness callback
+  void*                     data;       // user data passed to the callback
+  struct ProcessWatchStream streams[4]; // stdin, stdout, stderr and exit
+  int                       sweep;      // exit is polled for (no pidfd)
+  int                       feeding;    // stdin is only watched to drain
+                                        //   the Process' feed
+  int                       drain;      // stdout/stderr are drained by the
+                                        //   group (edge-triggered)
+  int                       requested;  // PROCESS_WATCH_* mask it was added
+                                        //   with
+  int                       dead;       // removed while events were pending
+  struct ProcessWatch*      prev;       // previous watch in the group
+  struct ProcessWatch*      next;       // next watch in the group
+  struct ProcessWatch*      garbage;    // next watch removed in this poll
+};
+
+// The number of buckets in the executable lookup cache
+#define _PROCESS_LOOKUP_BUCKETS 64
+
+// The most PATH directories whose changes are tracked per cached lookup
+#define _PROCESS_LOOKUP_DIRS 64
+
+// Executable resolved by process_create_lookup
+struct ProcessLookupEntry {
+  struct ProcessLookupEntry* next; // next entry in the bucket
+  size_t  hash;    // hash of the name
+  char*   name;    // the name that was looked up
+  char*   search;  // the PATH it was looked up in
+  char*   path;    // the resolved path
+  size_t  dirs;    // number of PATH directories searched to find it
+  int64_t mtimes[_PROCESS_LOOKUP_DIRS]; // modification times of those dirs
+};
+
+// Atomic access to the global state shared by every thread
+#if defined(__GNUC__) || defined(__clang__)
+#define _PROCESS_LOAD(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define _PROCESS_STORE(var, val) \
+  __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+#define _PROCESS_CAS(var, expected, val) \
+  __atomic_compare_exchange_n(&(var), &(expected), (val), 0, \
+    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define _PROCESS_REF_ADD(var) __atomic_add_fetch(&(var), 1, __ATOMIC_ACQ_REL)
+#define _PROCESS_REF_SUB(var) __atomic_sub_fetch(&(var), 1, __ATOMIC_ACQ_REL)
+#else
+#define _PROCESS_LOAD(var) (var)
+#define _PROCESS_STORE(var, val) ((var) = (val))
+#define _PROCESS_CAS(var, expected, val) \
+  ((var) == (expected) ? ((var) = (val), 1) : ((expected) = (var), 0))
+#define _PROCESS_REF_ADD(var) (++(var))
+#define _PROCESS_REF_SUB(var) (--(var))
+#endif
+
+// Relaxed access to a statistics counter (only its own thread adds to it, so
+//   no atomic read-modify-write is needed)
+#if defined(__GNUC__) || defined(__clang__)
+#define _PROCESS_COUNTER_READ(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define _PROCESS_COUNTER_ADD(var, n) \
+  __atomic_store_n(&(var), __atomic_load_n(&(var), __ATOMIC_RELAXED) + (n), \
+    __ATOMIC_RELAXED)
+#else
+#define _PROCESS_COUNTER_READ(var) (var)
+#define _PROCESS_COUNTER_ADD(var, n) ((var) += (n))
+#endif
+
+// Adds n to one of the calling thread's statistics counters
+#define _PROCESS_STAT(field, n) do { \
+    struct ProcessStats* _stats = _process_stats(); \
+    if (_stats != NULL) { \
+      _PROCESS_COUNTER_ADD(_stats->field, (n)); \
+    } \
+  } while (0)
+
+// Statistics counters of one thread
+struct ProcessStatsSlot {
+  struct ProcessStats      stats; // the thread's counters
+  struct ProcessStatsSlot* prev;  // previous thread's counters
+  struct ProcessStatsSlot* next;  // next thread's counters
+};
+
+// The number of 1 ms slots in a ProcessSupervisor's timer wheel (restarts
+//   due later wait in their slot for as many turns as needed)
+#define _PROCESS_WHEEL_SLOTS 1024
+
+// Default restart backoff of a ProcessSupervisor (ms)
+#define _PROCESS_BACKOFF_MIN 1
+#define _PROCESS_BACKOFF_MAX 30000
+
+// Supervision state of a Process
+struct ProcessService {
+  struct ProcessSupervisor* sup;    // the supervisor
+  struct Process*       p;          // the supervised Process
+  int                   policy;     // restart policy (PROCESS_RESTART_*)
+  int                   max_restarts; // restarts allowed per window (0 for
+                                      //   no limit)
+  int                   window;     // length of the window (ms, 0 for ever)
+  int64_t               window_start; // when the current window began (ms)
+  int                   window_count; // restarts in the current window
+  int                   backoff;    // delay before the next restart (ms)
+  int64_t               started;    // when the Process was last launched (ms)
+  int64_t               due;        // when the pending restart is due (ms)
+  int                   queued;     // 0, or 1 in the wheel, 2 in the due list
+  ProcessExitCallback   exit_callback; // the Process' own exit callback
+  void*                 exit_data;  // user data passed to exit_callback
+  int                   streams;    // streams watched in the supervisor's
+                                    //   group, restored after a restart
+  ProcessEventCallback  callback;   // readiness callback of those streams
+  void*                 data;       // user data passed to callback
+  struct ProcessService* prev;      // previous supervised Process
+  struct ProcessService* next;      // next supervised Process
+  struct ProcessService* qprev;     // previous restart in the same queue
+  struct ProcessService* qnext;     // next restart in the same queue
+};
+
+// The most freed Process objects each thread keeps for reuse
+#define _PROCESS_CACHE_MAX 16
+
+// Capture buffers larger than this aren't kept with a cached Process
+#define _PROCESS_CACHE_BUFFER 65536
+
+// Freed Process objects kept by one thread for its next process_create
+struct ProcessCache {
+  struct Process* items[_PROCESS_CACHE_MAX]; // the cached objects
+  size_t          count;                     // number of cached objects
+};
+
+// The engine used by Process objects that don't select one explicitly
+static int _process_default_engine = PROCESS_ENGINE_FORK;
+
+// A /dev/null fd (close-on-exec) shared by every launch, opened on first use
+static int _process_devnull = -1;
+
+// Cache of executables resolved by process_create_lookup
+static pthread_mutex_t _process_lookup_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ProcessLookupEntry* _process_lookup_cache[
+  _PROCESS_LOOKUP_BUCKETS];
+
+// Counters of the running threads (each in thread-specific storage), those
+//   folded in from threads that have exited, and the totals at the last
+//   process_reset_stats
+static pthread_mutex_t _process_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t  _process_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t   _process_stats_key;
+static int             _process_stats_ready = 0;
+static struct ProcessStatsSlot* _process_stats_head = NULL;
+static struct ProcessStats _process_stats_retired;
+static struct ProcessStats _process_stats_base;
+
+// Each thread's cache of freed Process objects (in thread-specific storage)
+static pthread_once_t _process_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  _process_cache_key;
+static int            _process_cache_ready = 0;
+
+// The trace hook called around each phase of a launch (or NULL)
+static ProcessTraceCallback _process_trace_hook = NULL;
+static void* _process_trace_data = NULL;
+
+// The parent's end of the zygote socket and the zygote's pid (one launch
+//   request is in flight at a time, under the lock)
+static pthread_mutex_t _process_zygote_lock = PTHREAD_MUTEX_INITIALIZER;
+static int   _process_zygote_fd  = -1;
+static pid_t _process_zygote_pid = -1;
+
+// The pipe the zygote's SIGCHLD handler writes to, waking its loop to reap
+//   (only used in the zygote)
+static int _process_zygote_wake[2] = { -1, -1 };
+
+#ifdef __linux__
+// Arguments of the clone3 system call (struct clone_args, version 2)
+struct ProcessCloneArgs {
+  uint64_t flags;        // CLONE_* flags
+  uint64_t pidfd;        // where to store the pidfd (CLONE_PIDFD)
+  uint64_t child_tid;    // where to store the child's tid in the child
+  uint64_t parent_tid;   // where to store the child's tid in the parent
+  uint64_t exit_signal;  // signal sent to the parent when the child exits
+  uint64_t stack;        // child's stack (0 to share the parent's layout)
+  uint64_t stack_size;   // size of the child's stack
+  uint64_t tls;          // child's thread-local storage
+  uint64_t set_tid;      // pids to request in each pid namespace
+  uint64_t set_tid_size; // number of pids in set_tid
+  uint64_t cgroup;       // cgroup directory fd (CLONE_INTO_CGROUP)
+};
+#endif
+
+// Launch request header sent to the zygote (followed by path, argv and envp
+//   as consecutive NUL-terminated strings, and the stdio fds as SCM_RIGHTS)
+struct ProcessZygoteRequest {
+  uint32_t size; // size of the string block that follows
+  uint32_t argc; // number of arguments in the string block
+  uint32_t envc; // number of environment variables in the string block
+};
+
+// The fds attached to a launch reply as SCM_RIGHTS, in this order
+#define _PROCESS_ZYGOTE_EXIT  0x1 // the read end of the child's exit pipe
+#define _PROCESS_ZYGOTE_PIDFD 0x2 // the child's pidfd
+
+// Launch reply sent back by the zygote
+struct ProcessZygoteReply {
+  pid_t pid;      // pid of the new process, or -1 upon failure
+  int   error;    // errno describing the failure
+  int   attached; // mask of the fds attached (_PROCESS_ZYGOTE_*)
+};
+
+// Exit of a child of the zygote, written to its exit pipe once reaped
+struct ProcessZygoteExit {
+  int           status; // wait status
+  struct rusage usage;  // resource usage
+};
+
+// Child of the zygote whose exit is reported to the parent
+struct ProcessZygoteChild {
+  pid_t pid; // pid of the child
+  int   fd;  // write end of its exit pipe
+};
+
+// The children of the zygote still running (only used in the zygote)
+static struct ProcessZygoteChild* _process_zygote_children = NULL;
+static size_t _process_zygote_child_count = 0;
+static size_t _process_zygote_child_cap   = 0;
+
+/**
+ * @brief Process Arena Allocate
+ *
+ * Reserves storage for len bytes in an arena
+ *
+ * @remarks
+ * Blocks are never moved, so earlier allocations stay valid; each new block
+ *   is at least twice as large as the previous one, so building n strings
+ *   costs O(log n) allocations
+ *
+ * @param[out] arena The arena
+ * @param      len   The number of bytes to reserve
+ *
+ * @return The reserved storage, or NULL upon failure
+ */
+char* _process_arena_alloc(struct ProcessArena* arena, size_t len) {
+  struct ProcessArenaBlock* block = arena->head;
+  if (block == NULL || block->size - block->used < len) {
+    // Allocate a larger block
+    size_t size = (block != NULL ? block->size * 2 : _PROCESS_ARENA_MIN);
+    if (size < len) {
+      size = len;
+    }
+    block = malloc(sizeof(struct ProcessArenaBlock) + size);
+    if (block == NULL) {
+      return NULL;
+    }
+    block->next = arena->head;
+    block->size = size;
+    block->used = 0;
+    arena->head = block;
+  }
+
+  char* ptr = block->data + block->used;
+  block->used += len;
+  return ptr;
+}
+
+/**
+ * @brief Process Arena Clear
+ *
+ * Frees every block of an arena
+ *
+ * @param[out] arena The arena
+ */
+void _process_arena_clear(struct ProcessArena* arena) {
+  while (arena->head != NULL) {
+    struct ProcessArenaBlock* next = arena->head->next;
+    free(arena->head);
+    arena->head = next;
+  }
+}
+
+/**
+ * @brief Process Arena Reset
+ *
+ * Empties an arena, keeping a single block for the next allocations
+ *
+ * @remarks
+ *  - Strings previously allocated in the arena are invalidated
+ *  - An arena of several blocks is merged into one as large as all of them,
+ *    so strings that filled it before fit again without allocating (the
+ *    largest block is kept if that allocation fails)
+ *
+ * @param[out] arena The arena
+ */
+void _process_arena_reset(struct ProcessArena* arena) {
+  struct ProcessArenaBlock* block = arena->head;
+  if (block != NULL && block->next != NULL) {
+    size_t size = 0;
+    for (struct ProcessArenaBlock* b = block; b != NULL; b = b->next) {
+      size += b->size;
+    }
+    struct ProcessArenaBlock* merged =
+      malloc(sizeof(struct ProcessArenaBlock) + size);
+    if (merged != NULL) {
+      _process_arena_clear(arena);
+      merged->next = NULL;
+      merged->size = size;
+      arena->head  = merged;
+      block        = merged;
+    }
+    else {
+      while (block->next != NULL) {
+        struct ProcessArenaBlock* next = block->next->next;
+        free(block->next);
+        block->next = next;
+      }
+    }
+  }
+  if (block != NULL) {
+    block->used = 0;
+  }
+}
+
+/**
+ * @brief Process Array Append
+ *
+ * Appends an item to an array without copying it
+ *
+ * @remarks
+ * The array grows geometrically, so n appends cost O(n) time and O(log n)
+ *   reallocations
+ *
+ * @param[out] arr   The array to append an item
+ * @param[out] count The number of elements in the array
+ * @param[out] cap   The number of slots allocated for the array
+ * @param      item  The item to append
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_array_append(char*** arr, size_t* count, size_t* cap,
+    char* item) {
+  // Make room for the item and the terminating NULL
+  if (*count + 2 > *cap) {
+    size_t n = (*cap > 0 ? *cap * 2 : 8);
+    if (!_process_array_reserve(arr, cap, n - 1)) {
+      return 0;
+    }
+  }
+  // Store item and NULL the last element
+  (*arr)[*count] = item;
+  (*count)++;
+  (*arr)[*count] = NULL;
+  return 1;
+}
 
 /**
  * @brief Process Array Count
@@ -38,315 +631,6646 @@ int _process_array_count(char* const arr[]) {
 }
 
 /**
- * @brief Process Array Clear
+ * @brief Process Array Clear
+ *
+ * Frees the array and the arena storing its elements
+ *
+ * @remarks
+ * The provided array variable is NULLed
+ *
+ * @param[out] arr   The array to clear
+ * @param[out] count The number of elements in the array
+ * @param[out] cap   The number of slots allocated for the array
+ * @param[out] arena The arena storing the elements of the array
+ */
+void _process_array_clear(char*** arr, size_t* count, size_t* cap,
+    struct ProcessArena* arena) {
+  if (arr != NULL) {
+    // Free elements
+    _process_arena_clear(arena);
+    // Free array
+    free(*arr);
+    *arr   = NULL;
+    *count = 0;
+    *cap   = 0;
+  }
+}
+
+/**
+ * @brief Process Array Push
+ *
+ * Appends a copy of an item to an array
+ *
+ * @remarks
+ * The item is copied into the arena rather than into its own allocation
+ *
+ * @param[out] arr   The array to append an item
+ * @param[out] count The number of elements in the array
+ * @param[out] cap   The number of slots allocated for the array
+ * @param[out] arena The arena storing the elements of the array
+ * @param      item  The item to append
+ */
+void _process_array_push(char*** arr, size_t* count, size_t* cap,
+    struct ProcessArena* arena, const char* item) {
+  // Copy item to the arena
+  size_t len = strlen(item) + 1;
+  char* copy = _process_arena_alloc(arena, len);
+  if (copy != NULL) {
+    memcpy(copy, item, len);
+    _process_array_append(arr, count, cap, copy);
+  }
+}
+
+/**
+ * @brief Process Array Reserve
+ *
+ * Allocates room for n elements (plus the terminating NULL) in an array
+ *
+ * @param[out] arr The array to grow
+ * @param[out] cap The number of slots allocated for the array
+ * @param      n   The number of elements to make room for
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_array_reserve(char*** arr, size_t* cap, size_t n) {
+  if (n > 0 && n + 1 > *cap) {
+    // Reallocate storage (terminating a newly allocated array)
+    char** grown = realloc(*arr, (n + 1) * sizeof(char*));
+    if (grown == NULL) {
+      return 0;
+    }
+    if (*arr == NULL) {
+      grown[0] = NULL;
+    }
+    *arr = grown;
+    *cap = n + 1;
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Array Reset
+ *
+ * Empties an array, keeping its pointer slots and its arena's storage
+ *
+ * @param[out] arr   The array to empty (or NULL)
+ * @param[out] count The number of elements in the array
+ * @param[out] arena The arena storing the elements of the array
+ */
+void _process_array_reset(char** arr, size_t* count,
+    struct ProcessArena* arena) {
+  _process_arena_reset(arena);
+  if (arr != NULL) {
+    arr[0] = NULL;
+  }
+  *count = 0;
+}
+
+/**
+ * @brief Process Cache
+ *
+ * Gets the calling thread's cache of freed Process objects
+ *
+ * @param create Whether to allocate the cache if the thread has none
+ *
+ * @return The thread's cache, or NULL if it has none
+ */
+struct ProcessCache* _process_cache(int create) {
+  pthread_once(&_process_cache_once, _process_cache_init);
+  if (!_process_cache_ready) {
+    return NULL;
+  }
+  struct ProcessCache* cache = pthread_getspecific(_process_cache_key);
+  if (cache == NULL && create) {
+    cache = calloc(1, sizeof(struct ProcessCache));
+    if (cache != NULL && pthread_setspecific(_process_cache_key, cache) != 0) {
+      free(cache);
+      cache = NULL;
+    }
+  }
+  return cache;
+}
+
+/**
+ * @brief Process Cache Exit
+ *
+ * Destroys the Process objects cached by an exiting thread
+ *
+ * @param cache The thread's cache (a struct ProcessCache)
+ */
+void _process_cache_exit(void* cache) {
+  struct ProcessCache* c = cache;
+  while (c->count > 0) {
+    _process_destroy(c->items[--c->count]);
+  }
+  free(c);
+}
+
+/**
+ * @brief Process Cache Initialize
+ *
+ * Creates the thread-specific key of the Process caches (run once)
+ */
+void _process_cache_init(void) {
+  _process_cache_ready = (pthread_key_create(&_process_cache_key,
+    _process_cache_exit) == 0);
+}
+
+/**
+ * @brief Process Capture
+ *
+ * Reads the output available on a captured stream into its buffer
+ *
+ * @remarks
+ * Shared by process_capture and the streams drained by process_group_poll
+ *
+ * @param[out] p      The Process object
+ * @param      stream The stream (PROCESS_STREAM_OUT or _ERR)
+ *
+ * @return The number of bytes captured, 0 at end of stream, or -1 upon
+ *   failure
+ */
+ssize_t _process_capture(struct Process* p, int stream) {
+  int fd = _process_stream_fd(p, stream);
+  if (fd == -1 || stream == PROCESS_STREAM_IN) {
+    errno = EBADF;
+    return -1;
+  }
+  struct ProcessCapture* c = &p->capture[stream];
+  if (c->mode != PROCESS_CAPTURE_FULL && c->mode != PROCESS_CAPTURE_RING) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ssize_t total = 0;
+  for (;;) {
+    ssize_t count;
+    if (c->mode == PROCESS_CAPTURE_RING) {
+      if (c->data == NULL) {
+        c->data = malloc(c->limit);
+        if (c->data == NULL) {
+          return (total > 0 ? total : -1);
+        }
+        c->cap = c->limit;
+      }
+
+      // Read into the ring starting after the newest byte
+      size_t end = (c->start + c->len) % c->cap;
+      struct iovec iov[2] = {
+        { c->data + end, c->cap - end },
+        { c->data,       end          }
+      };
+      count = readv(fd, iov, (end > 0 ? 2 : 1));
+      if (count > 0) {
+        c->len   = (c->len + (size_t)count > c->cap ? c->cap :
+          c->len + (size_t)count);
+        end      = (end + (size_t)count) % c->cap;
+        c->start = (end + c->cap - c->len) % c->cap;
+      }
+    }
+    else {
+      if (c->len == c->cap) {
+        // Grow the buffer geometrically
+        size_t cap = (c->cap > 0 ? c->cap * 2 : c->limit);
+        if (cap < _PROCESS_CAPTURE_MIN) {
+          cap = _PROCESS_CAPTURE_MIN;
+        }
+        char* data = realloc(c->data, cap);
+        if (data == NULL) {
+          return (total > 0 ? total : -1);
+        }
+        c->data = data;
+        c->cap  = cap;
+      }
+      count = read(fd, c->data + c->len, c->cap - c->len);
+      if (count > 0) {
+        c->len += (size_t)count;
+      }
+    }
+
+    if (count > 0) {
+      total += count;
+      _PROCESS_STAT(bytes_read, (uint64_t)count);
+    }
+    else if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    else if (count < 0 && errno == EIO && (p->options & PROCESS_OPTION_PTY)) {
+      // A pseudo-terminal's master reports the slave's close as EIO
+      return total;
+    }
+    else {
+      return (count == 0 || total > 0 ? total : -1);
+    }
+  }
+}
+
+/**
+ * @brief Process Capture Rotate
+ *
+ * Moves the contents of a capture ring so that they start at offset 0
+ *
+ * @remarks
+ * Rotates in place with three reversals, so no memory is allocated
+ *
+ * @param[out] c The capture
+ */
+void _process_capture_rotate(struct ProcessCapture* c) {
+  size_t n = c->start;
+  for (int pass = 0; pass < 3; pass++) {
+    // Reverse [0, n), then [n, cap), then the whole ring
+    size_t lo = (pass == 1 ? n : 0);
+    size_t hi = (pass == 0 ? n : c->cap);
+    while (hi > lo + 1) {
+      char tmp = c->data[lo];
+      c->data[lo++] = c->data[--hi];
+      c->data[hi]   = tmp;
+    }
+  }
+  c->start = 0;
+}
+
+/**
+ * @brief Process Child Cgroup
+ *
+ * Moves the calling child into the cgroup of its Process
+ *
+ * @remarks
+ *  - Only called in the child, after fork or vfork, where clone3 couldn't
+ *    place it atomically; fails the launch if it can't join the cgroup
+ *  - Writing 0 to cgroup.procs moves the writer, so no pid is formatted
+ *
+ * @param p      The Process object
+ * @param report The write end of the error pipe
+ */
+void _process_child_cgroup(struct Process* p, int report) {
+  if (p->cgroup_fd == -1) {
+    return;
+  }
+#ifdef __linux__
+  int fd = openat(p->cgroup_fd, "cgroup.procs", O_WRONLY | O_CLOEXEC);
+  if (fd != -1 && write(fd, "0", 1) == 1) {
+    close(fd);
+    return;
+  }
+#endif
+  _process_child_fail(report);
+}
+
+/**
+ * @brief Process Child Exec
+ *
+ * Wires the pipes to the standard streams and executes the binary
+ *
+ * @remarks
+ *  - Only called in the child, after fork or vfork; never returns
+ *  - Sticks to async-signal-safe calls so that it is valid after vfork
+ *  - A child fd of -1 leaves the inherited stream untouched
+ *  - Every other fd above stderr is closed at exec, except the fds passed
+ *    with process_pass_fd (and all of them with PROCESS_OPTION_INHERIT_FDS)
+ *  - With PROCESS_OPTION_PTY, the pseudo-terminal becomes the controlling
+ *    terminal of the new session (not when joining a process group)
+ *  - Resource limits and placement are applied after setsid (or setpgid),
+ *    right before execve
+ *  - Any failure is reported through the error pipe (closed by a successful
+ *    execve) before the child exits with status 127
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent
+ * @param report The write end of the error pipe
+ */
+void _process_child_exec(struct Process* p, const int child[3],
+    const int parent[3], int report) {
+  // Move the error pipe out of the way of the fds about to be replaced
+  int base = STDERR_FILENO + 1;
+  for (size_t i = 0; i < p->fd_count; i++) {
+    if (p->fds[i].child_fd >= base) {
+      base = p->fds[i].child_fd + 1;
+    }
+  }
+  if (report != -1 && report < base) {
+    report = fcntl(report, F_DUPFD_CLOEXEC, base);
+  }
+
+  // Prepare pipes
+  for (int i = 0; i < 3; i++) {
+    if (parent[i] != -1) {
+      close(parent[i]);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    if (child[i] != -1 && child[i] != i) {
+      dup2(child[i], i);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    if (child[i] > STDERR_FILENO) {
+      close(child[i]);
+    }
+  }
+  _process_child_fds(p);
+
+  // Create session and process group (or join the given process group)
+  if (p->pgid == -1) {
+    setsid();
+  }
+  else if (setpgid(0, p->pgid) != 0) {
+    _process_child_fail(report);
+  }
+
+  // Make the pseudo-terminal the new session's controlling terminal
+#ifdef TIOCSCTTY
+  if ((p->options & PROCESS_OPTION_PTY) && p->pgid == -1) {
+    int tty = (_process_stdio_mode(p, STDIN_FILENO) == PROCESS_STDIO_PIPE ?
+      STDIN_FILENO : STDOUT_FILENO);
+    if (_process_stdio_mode(p, tty) == PROCESS_STDIO_PIPE &&
+        ioctl(tty, TIOCSCTTY, 0) != 0) {
+      _process_child_fail(report);
+    }
+  }
+#endif
+
+  // Apply resource limits
+  for (size_t i = 0; i < p->rlimit_count; i++) {
+    if (setrlimit(p->rlimits[i].resource, &p->rlimits[i].limit) != 0) {
+      _process_child_fail(report);
+    }
+  }
+
+  // Apply CPU affinity and NUMA memory policy
+  if (p->placement != NULL && !_process_placement_apply(p->placement)) {
+    _process_child_fail(report);
+  }
+
+  // Run command
+  execve(p->path, p->argv, _process_environ(p));
+
+  // Report what went wrong
+  _process_child_fail(report);
+}
+
+/**
+ * @brief Process Child Fail
+ *
+ * Reports errno to the parent through the error pipe and exits the child
+ *
+ * @remarks
+ * Only called in the child; exits with 127 (as a shell does for a command it
+ *   can't run) in case the parent doesn't read the report
+ *
+ * @param report The write end of the error pipe (or -1)
+ */
+void _process_child_fail(int report) {
+  int error = errno;
+  while (report != -1 && write(report, &error, sizeof(error)) == -1 &&
+      errno == EINTR);
+  _exit(127);
+}
+
+/**
+ * @brief Process Child FDs
+ *
+ * Passes the extra fds of a Process to their child fd numbers and marks
+ *   every other fd above stderr close-on-exec
+ *
+ * @remarks
+ *  - Only called in the child, after fork or vfork
+ *  - The fds are first moved above every fd involved, so a mapping can name
+ *    another mapping's source as its target
+ *
+ * @param p The Process object
+ */
+void _process_child_fds(struct Process* p) {
+  size_t n = p->fd_count;
+  int moved[n > 0 ? n : 1];
+
+  // Move the fds out of the way of their targets
+  int base = STDERR_FILENO + 1;
+  for (size_t i = 0; i < n; i++) {
+    if (p->fds[i].fd >= base) {
+      base = p->fds[i].fd + 1;
+    }
+    if (p->fds[i].child_fd >= base) {
+      base = p->fds[i].child_fd + 1;
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    moved[i] = fcntl(p->fds[i].fd, F_DUPFD_CLOEXEC, base);
+  }
+
+  if (!(p->options & PROCESS_OPTION_INHERIT_FDS)) {
+    _process_fds_sweep(STDERR_FILENO + 1, 0);
+  }
+
+  // dup2 clears close-on-exec on the targets (the moved fds keep it)
+  for (size_t i = 0; i < n; i++) {
+    if (moved[i] != -1) {
+      dup2(moved[i], p->fds[i].child_fd);
+    }
+  }
+}
+
+/**
+ * @brief Process Destroy
+ *
+ * Frees a Process object and all of its storage
+ *
+ * @param[out] p The Process object
+ */
+void _process_destroy(struct Process* p) {
+  // Free path
+  if (p->path != NULL) {
+    free(p->path);
+    p->path = NULL;
+  }
+
+  // Clear arguments
+  _process_array_clear(&p->argv, &p->argc, &p->argv_cap, &p->argv_arena);
+
+  // Stop supervising and watching the Process
+  if (p->service != NULL) {
+    _process_service_detach(p->service);
+  }
+  if (p->watch != NULL) {
+    _process_watch_remove(p->watch);
+  }
+  if (p->pidfd != -1) {
+    close(p->pidfd);
+    p->pidfd = -1;
+  }
+  if (p->exit_fd != -1) {
+    close(p->exit_fd);
+    p->exit_fd = -1;
+  }
+
+  // Clear environment variables
+  _process_array_clear(&p->envp, &p->envc, &p->envp_cap, &p->envp_arena);
+  _process_env_index_clear(&p->env_index);
+  _process_env_template_drop(p->env_template);
+  p->env_template = NULL;
+  free(p->env_flat);
+  p->env_flat = NULL;
+
+  // Free captured output, extra fds and resource settings
+  for (int i = 0; i < 3; i++) {
+    free(p->capture[i].data);
+  }
+  free(p->fds);
+  free(p->rlimits);
+  free(p->placement);
+  if (p->cgroup_fd != -1) {
+    close(p->cgroup_fd);
+  }
+
+  // Drop the buffers queued for stdin
+  _process_feed_drop(p);
+  if (p->feed != NULL) {
+    free(p->feed->entries);
+    free(p->feed);
+  }
+
+  // Free the process
+  free(p);
+}
+
+/**
+ * @brief Process Engine
+ *
+ * Resolves the launch engine used for a Process
+ *
+ * @remarks
+ * posix_spawn and the zygote can't pass extra fds, apply resource limits,
+ *   join a cgroup, place the child or acquire a controlling terminal, so
+ *   those Process objects fall back to vfork (as do zygote launches joining
+ *   a process group of the parent's)
+ *
+ * @param p The Process object
+ *
+ * @return The engine (one of PROCESS_ENGINE_*, never _DEFAULT)
+ */
+int _process_engine(struct Process* p) {
+  int engine = p->engine;
+  if (engine == PROCESS_ENGINE_DEFAULT) {
+    engine = _PROCESS_LOAD(_process_default_engine);
+  }
+  if ((engine == PROCESS_ENGINE_SPAWN || engine == PROCESS_ENGINE_ZYGOTE) &&
+      (p->fd_count > 0 || p->rlimit_count > 0 || p->cgroup_fd != -1 ||
+       p->placement != NULL)) {
+    engine = PROCESS_ENGINE_VFORK;
+  }
+  if ((engine == PROCESS_ENGINE_SPAWN || engine == PROCESS_ENGINE_ZYGOTE) &&
+      (p->options & PROCESS_OPTION_PTY)) {
+    engine = PROCESS_ENGINE_VFORK;
+  }
+  if (engine == PROCESS_ENGINE_ZYGOTE && p->pgid != -1) {
+    engine = PROCESS_ENGINE_VFORK;
+  }
+  return engine;
+}
+
+/**
+ * @brief Process Escalate
+ *
+ * Sends SIGKILL to a Process whose termination deadline has passed
+ *
+ * @param[out] p   The Process object
+ * @param      now The current monotonic time in milliseconds
+ *
+ * @return 1 if the Process was killed, 0 otherwise
+ */
+int _process_escalate(struct Process* p, int64_t now) {
+  if (p->deadline == 0 || now < p->deadline || p->exited) {
+    return 0;
+  }
+  p->deadline = 0;
+  _process_signal(p, SIGKILL);
+  return 1;
+}
+
+/**
+ * @brief Process Environment Flatten
+ *
+ * Merges the Process' environment template with its own environment
+ *   variables into env_flat, if it has changed since the last launch
+ *
+ * @remarks
+ *  - Variables in envp override template variables with the same name, and
+ *    names unset with process_unset_env are left out
+ *  - env_flat only points at strings owned by the template and by envp, so
+ *    nothing is copied
+ *
+ * @param[out] p The Process object
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_env_flatten(struct Process* p) {
+  struct ProcessEnvTemplate* t = p->env_template;
+  if (t == NULL || !p->env_dirty) {
+    return 1;
+  }
+
+  // Make room for every variable
+  size_t count = 0;
+  if (!_process_array_reserve(&p->env_flat, &p->env_flat_cap,
+        t->envc + p->envc)) {
+    return 0;
+  }
+
+  // Copy the template variables that aren't overridden or unset
+  for (size_t i = 0; i < t->envc; i++) {
+    size_t len = strcspn(t->envp[i], "=");
+    if (_process_env_index_find(&p->env_index, t->envp[i], len) == NULL) {
+      p->env_flat[count++] = t->envp[i];
+    }
+  }
+
+  // Copy the Process' own variables
+  for (size_t i = 0; i < p->envc; i++) {
+    p->env_flat[count++] = p->envp[i];
+  }
+  p->env_flat[count] = NULL;
+
+  p->env_dirty = 0;
+  return 1;
+}
+
+/**
+ * @brief Process Environment Hash
+ *
+ * Hashes an environment variable name (FNV-1a)
+ *
+ * @param name The name
+ * @param len  The length of the name
+ *
+ * @return The hash of the name
+ */
+size_t _process_env_hash(const char* name, size_t len) {
+  size_t hash = (size_t)2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= (size_t)16777619u;
+  }
+  return hash;
+}
+
+/**
+ * @brief Process Environment Index Clear
+ *
+ * Frees the slots of an environment index
+ *
+ * @param[out] ix The environment index
+ */
+void _process_env_index_clear(struct ProcessEnvIndex* ix) {
+  free(ix->slots);
+  ix->slots = NULL;
+  ix->cap   = 0;
+  ix->count = 0;
+}
+
+/**
+ * @brief Process Environment Index Find
+ *
+ * Finds the slot of an environment variable name
+ *
+ * @param ix   The environment index
+ * @param name The name (need not be NUL-terminated)
+ * @param len  The length of the name
+ *
+ * @return The slot, or NULL if the name isn't indexed
+ */
+struct ProcessEnvSlot* _process_env_index_find(struct ProcessEnvIndex* ix,
+    const char* name, size_t len) {
+  if (ix->count == 0) {
+    return NULL;
+  }
+
+  // Probe linearly from the home slot until an empty slot is reached
+  size_t hash = _process_env_hash(name, len);
+  size_t mask = ix->cap - 1;
+  for (size_t i = hash & mask; ix->slots[i].key != NULL; i = (i + 1) & mask) {
+    struct ProcessEnvSlot* slot = &ix->slots[i];
+    if (slot->hash == hash && slot->len == len &&
+        memcmp(slot->key, name, len) == 0) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Process Environment Index Insert
+ *
+ * Adds a name to an environment index
+ *
+ * @remarks
+ *  - The name must not already be indexed, and must outlive the index
+ *  - The table doubles once it is three quarters full
+ *
+ * @param[out] ix    The environment index
+ * @param      name  The name (need not be NUL-terminated)
+ * @param      len   The length of the name
+ * @param      index The position of the variable in envp (or SIZE_MAX)
+ *
+ * @return The new slot, or NULL upon failure
+ */
+struct ProcessEnvSlot* _process_env_index_insert(struct ProcessEnvIndex* ix,
+    const char* name, size_t len, size_t index) {
+  // Grow and rehash the table
+  if ((ix->count + 1) * 4 > ix->cap * 3) {
+    size_t cap = (ix->cap > 0 ? ix->cap * 2 : 16);
+    struct ProcessEnvSlot* slots = calloc(cap, sizeof(struct ProcessEnvSlot));
+    if (slots == NULL) {
+      return NULL;
+    }
+    for (size_t i = 0; i < ix->cap; i++) {
+      if (ix->slots[i].key != NULL) {
+        size_t j = ix->slots[i].hash & (cap - 1);
+        while (slots[j].key != NULL) {
+          j = (j + 1) & (cap - 1);
+        }
+        slots[j] = ix->slots[i];
+      }
+    }
+    free(ix->slots);
+    ix->slots = slots;
+    ix->cap   = cap;
+  }
+
+  // Store the name in the first empty slot
+  size_t hash = _process_env_hash(name, len);
+  size_t mask = ix->cap - 1;
+  size_t i = hash & mask;
+  while (ix->slots[i].key != NULL) {
+    i = (i + 1) & mask;
+  }
+  ix->slots[i].key   = name;
+  ix->slots[i].len   = len;
+  ix->slots[i].hash  = hash;
+  ix->slots[i].index = index;
+  ix->count++;
+  return &ix->slots[i];
+}
+
+/**
+ * @brief Process Environment Index Remove
+ *
+ * Removes a slot from an environment index
+ *
+ * @remarks
+ * Later slots of the probe sequence are shifted back, so no tombstones are
+ *   left behind
+ *
+ * @param[out] ix   The environment index
+ * @param[out] slot The slot to remove
+ */
+void _process_env_index_remove(struct ProcessEnvIndex* ix,
+    struct ProcessEnvSlot* slot) {
+  size_t mask = ix->cap - 1;
+  size_t hole = (size_t)(slot - ix->slots);
+  for (size_t i = (hole + 1) & mask; ix->slots[i].key != NULL;
+      i = (i + 1) & mask) {
+    // Move the slot into the hole unless its home lies after the hole
+    size_t home = ix->slots[i].hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      ix->slots[hole] = ix->slots[i];
+      hole = i;
+    }
+  }
+  ix->slots[hole].key = NULL;
+  ix->count--;
+}
+
+/**
+ * @brief Process Environment Index Reset
+ *
+ * Removes every name from an environment index, keeping its slots
+ *
+ * @param[out] ix The index
+ */
+void _process_env_index_reset(struct ProcessEnvIndex* ix) {
+  if (ix->slots != NULL) {
+    memset(ix->slots, 0, ix->cap * sizeof(struct ProcessEnvSlot));
+  }
+  ix->count = 0;
+}
+
+/**
+ * @brief Process Environment Name Equal
+ *
+ * Compares the names of two environment variables
+ *
+ * @param a The first environment variable ("NAME=value")
+ * @param b The second environment variable ("NAME=value")
+ *
+ * @return 1 if both variables have the same name, 0 otherwise
+ */
+int _process_env_name_equal(const char* a, const char* b) {
+  size_t len = strcspn(a, "=");
+  return (strncmp(a, b, len) == 0 && (b[len] == '=' || b[len] == '\0'));
+}
+
+/**
+ * @brief Process Environment Put
+ *
+ * Stores an environment variable, replacing one with the same name
+ *
+ * @remarks
+ *  - env must already be owned by the array's arena
+ *  - Variables without a '=' are appended without being indexed
+ *
+ * @param[out] arr   The environment variable array
+ * @param[out] count The number of elements in the array
+ * @param[out] cap   The number of slots allocated for the array
+ * @param[out] ix    The index of the names in the array
+ * @param      env   The environment variable ("NAME=value")
+ */
+void _process_env_put(char*** arr, size_t* count, size_t* cap,
+    struct ProcessEnvIndex* ix, char* env) {
+  char* eq = strchr(env, '=');
+  if (eq == NULL) {
+    _process_array_append(arr, count, cap, env);
+    return;
+  }
+
+  size_t len = (size_t)(eq - env);
+  struct ProcessEnvSlot* slot = _process_env_index_find(ix, env, len);
+  if (slot != NULL && slot->index != SIZE_MAX) {
+    // Override the variable in place
+    (*arr)[slot->index] = env;
+    slot->key = env;
+  }
+  else if (_process_array_append(arr, count, cap, env)) {
+    // Index the new variable (or revive a name that was unset)
+    if (slot != NULL) {
+      slot->key   = env;
+      slot->index = *count - 1;
+    }
+    else {
+      _process_env_index_insert(ix, env, len, *count - 1);
+    }
+  }
+}
+
+/**
+ * @brief Process Environment Template Drop
+ *
+ * Drops a reference to an environment template, destroying it with the last
+ *
+ * @param[out] t The environment template (or NULL)
+ */
+void _process_env_template_drop(struct ProcessEnvTemplate* t) {
+  if (t != NULL && _PROCESS_REF_SUB(t->refs) == 0) {
+    _process_env_index_clear(&t->index);
+    _process_arena_clear(&t->arena);
+    free(t->envp);
+    free(t);
+  }
+}
+
+/**
+ * @brief Process Environ
+ *
+ * Gets the environment to execute the Process with
+ *
+ * @remarks
+ * Never allocates, so it is safe to call in the child; _process_env_flatten
+ *   must have been called first if the Process has an environment template
+ *
+ * @param p The Process object
+ *
+ * @return The environment variable list (terminated with NULL pointer)
+ */
+char** _process_environ(struct Process* p) {
+  return (p->env_template != NULL ? p->env_flat : p->envp);
+}
+
+/**
+ * @brief Process Exec Wait
+ *
+ * Waits for a fork or vfork child to exec, collecting the launch error it
+ *   reported (if any)
+ *
+ * @remarks
+ *  - The error pipe is close-on-exec, so a successful execve closes the
+ *    child's end and the read returns 0 bytes; a failing child writes errno
+ *    first and is reaped here
+ *  - Closes both ends of the error pipe
+ *
+ * @param[out] p      The Process object
+ * @param      pid    The pid of the child, or -1 if it wasn't created
+ * @param      report The error pipe (both ends -1 if there isn't one)
+ *
+ * @return pid, or -1 upon failure (with errno set to the child's error)
+ */
+pid_t _process_exec_wait(struct Process* p, pid_t pid, const int report[2]) {
+  if (report[0] == -1) {
+    return pid;
+  }
+  int error = errno;
+  close(report[1]);
+  if (pid != -1) {
+    int child_error;
+    ssize_t count;
+    do {
+      count = read(report[0], &child_error, sizeof(child_error));
+    } while (count == -1 && errno == EINTR);
+    if (count == (ssize_t)sizeof(child_error)) {
+      // The child exits right after reporting
+      while (waitpid(pid, NULL, 0) == -1 && errno == EINTR);
+      if (p->pidfd != -1) {
+        close(p->pidfd);
+        p->pidfd = -1;
+      }
+      error = child_error;
+      pid   = -1;
+    }
+  }
+  close(report[0]);
+  errno = error;
+  return pid;
+}
+
+/**
+ * @brief Process FDs Sweep
+ *
+ * Marks every fd from first on close-on-exec, or closes it
+ *
+ * @remarks
+ *  - Only called in the child and the zygote; async-signal-safe (no
+ *    allocation)
+ *  - Uses close_range where the kernel supports it, then a getdents walk of
+ *    /proc/self/fd, and finally a loop up to the fd limit (the soft
+ *    RLIMIT_NOFILE, or the hard one when the soft one is unlimited), capped
+ *    at _PROCESS_FDS_MAX: that loop misses any fd past the cap
+ *
+ * @param first      The lowest fd to sweep
+ * @param close_them 1 to close the fds, 0 to mark them close-on-exec
+ */
+void _process_fds_sweep(int first, int close_them) {
+#ifdef __linux__
+#ifdef SYS_close_range
+  if (syscall(SYS_close_range, first, ~0U,
+        (close_them ? 0 : CLOSE_RANGE_CLOEXEC)) == 0) {
+    return;
+  }
+#endif
+
+  // Walk the open fds (procfs lists them by number, so marking or closing
+  //   them doesn't disturb the listing)
+  int dir = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir != -1) {
+    char buf[_PROCESS_FDS_BUFFER];
+    long len;
+    while ((len = syscall(SYS_getdents64, dir, buf, sizeof(buf))) > 0) {
+      for (long pos = 0; pos < len;) {
+        struct dirent64* entry = (struct dirent64*)(buf + pos);
+        int fd = 0;
+        const char* name = entry->d_name;
+        for (; *name >= '0' && *name <= '9'; name++) {
+          fd = fd * 10 + (*name - '0');
+        }
+        if (*name == '\0' && name != entry->d_name && fd >= first &&
+            fd != dir) {
+          if (close_them) {
+            close(fd);
+          }
+          else {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+          }
+        }
+        pos += entry->d_reclen;
+      }
+    }
+    close(dir);
+    if (len == 0) {
+      return;
+    }
+  }
+#endif
+
+  // Mark every possible fd
+  struct rlimit limit;
+  rlim_t max = _PROCESS_FDS_MAX;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    rlim_t bound = (limit.rlim_cur != RLIM_INFINITY ? limit.rlim_cur :
+      limit.rlim_max);
+    if (bound != RLIM_INFINITY && bound < max) {
+      max = bound;
+    }
+  }
+  for (int fd = first; (rlim_t)fd < max; fd++) {
+    if (close_them) {
+      close(fd);
+    }
+    else {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+}
+
+/**
+ * @brief Process Feed Drop
+ *
+ * Drops every buffer queued for a Process' stdin
+ *
+ * @remarks
+ * The completion callbacks of caller-owned buffers are called with written
+ *   set to 0
+ *
+ * @param[out] p The Process object
+ */
+void _process_feed_drop(struct Process* p) {
+  struct ProcessFeed* f = p->feed;
+  while (f != NULL && f->count > 0) {
+    struct ProcessFeedEntry e = f->entries[f->head];
+    f->head     = (f->head + 1) & (f->cap - 1);
+    f->count   -= 1;
+    f->pending -= e.iov.iov_len;
+    free(e.owned);
+    if (e.callback != NULL) {
+      e.callback(p, e.data, 0);
+    }
+  }
+  if (f != NULL) {
+    f->closing = 0;
+  }
+  _process_feed_watch(p);
+}
+
+/**
+ * @brief Process Feed Flush
+ *
+ * Writes as many queued buffers to a Process' stdin as the pipe accepts
+ *
+ * @remarks
+ * Shared by process_feed_flush, process_feed_close and process_group_poll
+ *
+ * @param[out] p The Process object
+ *
+ * @return The number of bytes still queued, or -1 upon failure
+ */
+ssize_t _process_feed_flush(struct Process* p) {
+  struct ProcessFeed* f = p->feed;
+  if (f == NULL) {
+    return 0;
+  }
+
+  // A pseudo-terminal's master isn't a pipe, so it can't be spliced into
+  int splice = ((p->options & PROCESS_OPTION_VMSPLICE) &&
+    !(p->options & PROCESS_OPTION_PTY) ? 1 : 0);
+  while (f->count > 0 && p->in != -1) {
+    // Gather the oldest buffers (only caller-owned ones, or only copies, when
+    //   caller-owned buffers are spliced)
+    struct iovec iov[_PROCESS_FEED_IOVS];
+    int n = 0;
+    int owned = (f->entries[f->head].owned != NULL);
+    for (size_t i = 0; i < f->count && n < _PROCESS_FEED_IOVS; i++) {
+      struct ProcessFeedEntry* e = &f->entries[(f->head + i) & (f->cap - 1)];
+      if (splice && (e->owned != NULL) != owned) {
+        break;
+      }
+      if (e->iov.iov_len > 0) {
+        iov[n++] = e->iov;
+      }
+    }
+
+    ssize_t count = 0;
+    if (n > 0) {
+#ifdef __linux__
+      if (splice && !owned) {
+        // Map the caller's pages into the pipe instead of copying them
+        count = vmsplice(p->in, iov, (unsigned long)n,
+          ((p->options & PROCESS_OPTION_NONBLOCK) ? SPLICE_F_NONBLOCK : 0));
+        if (count < 0 && (errno == EINVAL || errno == ENOSYS)) {
+          splice = 0;
+          continue;
+        }
+      }
+      else {
+        count = writev(p->in, iov, n);
+      }
+#else
+      count = writev(p->in, iov, n);
+#endif
+      if (count < 0 && errno == EINTR) {
+        continue;
+      }
+      if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      if (count < 0) {
+        int error = errno;
+        _process_feed_drop(p);
+        errno = error;
+        return -1;
+      }
+    }
+
+    // Retire the buffers that were written in full
+    size_t done = (size_t)count;
+    f->pending -= done;
+    while (f->count > 0) {
+      struct ProcessFeedEntry* e = &f->entries[f->head];
+      if (e->iov.iov_len > done) {
+        e->iov.iov_base = (char*)e->iov.iov_base + done;
+        e->iov.iov_len -= done;
+        break;
+      }
+      done -= e->iov.iov_len;
+      struct ProcessFeedEntry retired = *e;
+      f->head   = (f->head + 1) & (f->cap - 1);
+      f->count -= 1;
+      free(retired.owned);
+      if (retired.callback != NULL) {
+        retired.callback(p, retired.data, 1);
+      }
+    }
+  }
+
+  // Close stdin once everything has been written
+  if (f->count == 0 && f->closing && p->in != -1) {
+    if (p->watch != NULL) {
+      _process_watch_stream_remove(&p->watch->streams[PROCESS_STREAM_IN]);
+      p->watch->feeding = 0;
+    }
+    close(p->in);
+    p->in = -1;
+  }
+  _process_feed_watch(p);
+  return (ssize_t)f->pending;
+}
+
+/**
+ * @brief Process Feed Get
+ *
+ * Gets the stdin feed of a Process, allocating it on first use
+ *
+ * @param[out] p The Process object
+ *
+ * @return The feed, or NULL upon failure
+ */
+struct ProcessFeed* _process_feed_get(struct Process* p) {
+  if (p->feed == NULL) {
+    p->feed = calloc(1, sizeof(struct ProcessFeed));
+  }
+  return p->feed;
+}
+
+/**
+ * @brief Process Feed Push
+ *
+ * Queues a buffer for a Process' stdin
+ *
+ * @remarks
+ *  - The ring of buffers grows geometrically
+ *  - A Process in a ProcessGroup starts being watched for writability
+ *
+ * @param[out] p        The Process object
+ * @param      base     The bytes to write
+ * @param      len      The number of bytes to write
+ * @param      owned    Storage freed once the buffer is written (or NULL)
+ * @param      spare    Unused bytes of owned after the buffer
+ * @param      callback Called once the buffer is done (or NULL)
+ * @param      data     User data passed to the callback
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_feed_push(struct Process* p, const void* base, size_t len,
+    void* owned, size_t spare, ProcessFeedCallback callback, void* data) {
+  struct ProcessFeed* f = _process_feed_get(p);
+  if (f == NULL) {
+    return 0;
+  }
+  if (f->count == f->cap) {
+    // Grow the ring, unwrapping it into the new storage
+    size_t cap = (f->cap > 0 ? f->cap * 2 : 8);
+    struct ProcessFeedEntry* entries = malloc(cap *
+      sizeof(struct ProcessFeedEntry));
+    if (entries == NULL) {
+      return 0;
+    }
+    for (size_t i = 0; i < f->count; i++) {
+      entries[i] = f->entries[(f->head + i) & (f->cap - 1)];
+    }
+    free(f->entries);
+    f->entries = entries;
+    f->head    = 0;
+    f->cap     = cap;
+  }
+
+  struct ProcessFeedEntry* e = &f->entries[(f->head + f->count) &
+    (f->cap - 1)];
+  e->iov.iov_base = (void*)base;
+  e->iov.iov_len  = len;
+  e->owned    = owned;
+  e->spare    = spare;
+  e->callback = callback;
+  e->data     = data;
+  f->count   += 1;
+  f->pending += len;
+  _process_feed_watch(p);
+  return 1;
+}
+
+/**
+ * @brief Process Feed Watch
+ *
+ * Watches a Process' stdin for writability exactly while its feed has
+ *   buffers queued
+ *
+ * @remarks
+ * Only applies to a Process in a ProcessGroup whose stdin wasn't watched
+ *   through process_group_add already
+ *
+ * @param[out] p The Process object
+ */
+void _process_feed_watch(struct Process* p) {
+  struct ProcessWatch* w = p->watch;
+  if (w == NULL) {
+    return;
+  }
+  struct ProcessWatchStream* ws = &w->streams[PROCESS_STREAM_IN];
+  int queued = (p->feed != NULL && p->feed->count > 0 && p->in != -1);
+  if (queued && ws->fd == -1) {
+    ws->fd = p->in;
+    if (_process_group_register(w->group, ws, 1)) {
+      w->feeding = 1;
+    }
+    else {
+      ws->fd = -1;
+    }
+  }
+  else if (!queued && w->feeding) {
+    _process_watch_stream_remove(ws);
+    w->feeding = 0;
+  }
+}
+
+/**
+ * @brief Process Group Drain
+ *
+ * Reads everything available on a stream drained by a ProcessGroup
+ *
+ * @remarks
+ *  - A captured stream is read into its capture buffer; any other stream is
+ *    read with readv into buffers of the group's slab pool, which are handed
+ *    to the group's data callback and then returned to the pool
+ *  - The stream is edge-triggered, so it is read until a short read (a
+ *    pipe signals every later write with a new edge) or until end of stream
+ *    once the writer has hung up
+ *  - The data callback is called with no buffers at end of stream
+ *
+ * @param[out] g      The ProcessGroup
+ * @param[out] ws     The watched stream
+ * @param      events The events reported for the stream (PROCESS_EVENT_*)
+ *
+ * @return 1 if the stream should stop being watched, 0 otherwise
+ */
+int _process_group_drain(struct ProcessGroup* g, struct ProcessWatchStream* ws,
+    int events) {
+  struct ProcessWatch* w = ws->watch;
+  struct Process* p = w->p;
+  int fd = ws->fd;
+  int stream = ws->stream;
+
+  // Read a captured stream into its buffer
+  int mode = p->capture[stream].mode;
+  if (mode == PROCESS_CAPTURE_FULL || mode == PROCESS_CAPTURE_RING) {
+    ssize_t count = _process_capture(p, stream);
+    int ended = (count == 0 || (count < 0 && errno != EAGAIN) ||
+      (events & PROCESS_EVENT_HANGUP));
+    if (ended && g->drain_callback != NULL) {
+      g->drain_callback(p, stream, NULL, 0, g->drain_data);
+    }
+    return ended;
+  }
+
+  for (;;) {
+    // Scatter the read across buffers of the pool
+    struct ProcessSlab* slabs[_PROCESS_SLAB_IOVS];
+    struct iovec iov[_PROCESS_SLAB_IOVS];
+    int n = 0;
+    for (; n < _PROCESS_SLAB_IOVS; n++) {
+      slabs[n] = _process_slab_get(g);
+      if (slabs[n] == NULL) {
+        break;
+      }
+      iov[n].iov_base = slabs[n]->data;
+      iov[n].iov_len  = _PROCESS_SLAB_SIZE;
+    }
+    if (n == 0) {
+      return 0;
+    }
+    ssize_t count = readv(fd, iov, n);
+    int error = errno;
+
+    // Hand the filled buffers to the callback
+    if (count > 0) {
+      _PROCESS_STAT(bytes_read, (uint64_t)count);
+      size_t filled = ((size_t)count + _PROCESS_SLAB_SIZE - 1) /
+        _PROCESS_SLAB_SIZE;
+      iov[filled - 1].iov_len = (size_t)count -
+        (filled - 1) * _PROCESS_SLAB_SIZE;
+      if (g->drain_callback != NULL) {
+        g->drain_callback(p, stream, iov, filled, g->drain_data);
+      }
+    }
+    for (int i = n - 1; i >= 0; i--) {
+      slabs[i]->next = g->slabs;
+      g->slabs = slabs[i];
+    }
+
+    // The callback may have closed, freed or removed the Process
+    if (w->dead || ws->fd != fd) {
+      return 0;
+    }
+    if (count < 0 && error == EINTR) {
+      continue;
+    }
+    if (count == 0 || (count < 0 && error == EIO &&
+        (p->options & PROCESS_OPTION_PTY))) {
+      if (g->drain_callback != NULL) {
+        g->drain_callback(p, stream, NULL, 0, g->drain_data);
+      }
+      return 1;
+    }
+    if (count < 0) {
+      return (error == EAGAIN || error == EWOULDBLOCK ? 0 : 1);
+    }
+    if ((size_t)count < (size_t)n * _PROCESS_SLAB_SIZE &&
+        !(events & PROCESS_EVENT_HANGUP)) {
+      return 0;
+    }
+  }
+}
+
+/**
+ * @brief Process Group Register
+ *
+ * Adds or removes a stream's fd in the group's epoll/kqueue set
+ *
+ * @remarks
+ * stdin is watched for writability, stdout and stderr for readability, and
+ *   the exit stream for the Process' exit (pidfd or EVFILT_PROC)
+ *
+ * @param g      The ProcessGroup
+ * @param ws     The watched stream (its fd must be set)
+ * @param enable 1 to add the fd, 0 to remove it
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_group_register(struct ProcessGroup* g,
+    struct ProcessWatchStream* ws, int enable) {
+  int writable = (ws->stream == PROCESS_STREAM_IN);
+  int edge = (ws->watch->drain && (ws->stream == PROCESS_STREAM_OUT ||
+    ws->stream == PROCESS_STREAM_ERR));
+#if defined(__linux__)
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events   = (writable ? EPOLLOUT : EPOLLIN) | (edge ? EPOLLET : 0);
+  ev.data.ptr = ws;
+  return (epoll_ctl(g->fd, (enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), ws->fd,
+    &ev) == 0 ? 1 : 0);
+#else
+  struct kevent ev;
+  if (ws->stream == _PROCESS_STREAM_EXIT) {
+    EV_SET(&ev, ws->fd, EVFILT_PROC, (enable ? EV_ADD : EV_DELETE),
+      NOTE_EXIT, 0, ws);
+  }
+  else {
+    EV_SET(&ev, ws->fd, (writable ? EVFILT_WRITE : EVFILT_READ),
+      (enable ? EV_ADD | (edge ? EV_CLEAR : 0) : EV_DELETE), 0, 0, ws);
+  }
+  return (kevent(g->fd, &ev, 1, NULL, 0, NULL) == 0 ? 1 : 0);
+#endif
+}
+
+/**
+ * @brief Process Group Deadlines
+ *
+ * Escalates the expired terminations of a group and finds the next deadline
+ *
+ * @remarks
+ * Only scans the members once the earliest deadline has passed
+ *
+ * @param[out] g   The ProcessGroup
+ * @param      now The current monotonic time in milliseconds
+ */
+void _process_group_deadlines(struct ProcessGroup* g, int64_t now) {
+  if (g->deadline == 0 || now < g->deadline) {
+    return;
+  }
+  g->deadline = 0;
+  for (struct ProcessWatch* w = g->head; w != NULL; w = w->next) {
+    struct Process* p = w->p;
+    if (!w->dead && !_process_escalate(p, now) && p->deadline != 0 &&
+        (g->deadline == 0 || p->deadline < g->deadline)) {
+      g->deadline = p->deadline;
+    }
+  }
+}
+
+/**
+ * @brief Process Launch
+ *
+ * Spawns the Process and hands it the parent's ends of its pipes
+ *
+ * @remarks
+ *  - The child's pipe ends are always closed; the parent's ends are closed
+ *    too if the launch fails (fds that aren't pipes are left open)
+ *  - Output captured by a previous launch is dropped (its storage is kept)
+ *  - The time from merging the environment to the child's launch is
+ *    recorded in the latency histogram
+ *  - Upon failure, the reason is recorded in p->error (including errors
+ *    the child hit before or during execve)
+ *
+ * @param[out] p      The Process object
+ * @param      child  The pipe ends to become stdin, stdout and stderr
+ * @param      parent The pipe ends kept by the parent
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_launch(struct Process* p, const int child[3],
+    const int parent[3]) {
+  // Launch the Process
+  int64_t start = _process_now_us();
+  p->pid    = -1;
+  p->zygote = 0;
+  p->error  = 0;
+  p->exited = 0;
+  p->status = 0;
+  _process_trace(p, PROCESS_PHASE_ENV, 0);
+  int flattened = _process_env_flatten(p);
+  _process_trace(p, PROCESS_PHASE_ENV, 1);
+  if (flattened) {
+    _process_trace(p, PROCESS_PHASE_SPAWN, 0);
+    p->pid = _process_spawn(p, child, parent);
+    _process_trace(p, PROCESS_PHASE_SPAWN, 1);
+  }
+  if (p->pid == -1) {
+    p->error = (errno != 0 ? errno : ECHILD);
+  }
+
+  // Prepare pipes (only piped streams have a parent's end)
+  for (int i = 0; i < 3; i++) {
+    if (parent[i] != -1) {
+      close(child[i]);
+    }
+  }
+  if (p->pid != -1) {
+    p->in  = parent[STDIN_FILENO];
+    p->out = parent[STDOUT_FILENO];
+    p->err = parent[STDERR_FILENO];
+
+    // Make the parent's ends non-blocking (the child's stay blocking)
+    if (p->options & PROCESS_OPTION_NONBLOCK) {
+      for (int i = 0; i < 3; i++) {
+        if (parent[i] != -1) {
+          fcntl(parent[i], F_SETFL, fcntl(parent[i], F_GETFL) | O_NONBLOCK);
+        }
+      }
+    }
+
+    // Start capturing afresh
+    for (int i = 0; i < 3; i++) {
+      p->capture[i].start = 0;
+      p->capture[i].len   = 0;
+    }
+  }
+  else {
+    for (int i = 0; i < 3; i++) {
+      if (parent[i] != -1) {
+        close(parent[i]);
+      }
+    }
+  }
+
+  // Count the launch
+  struct ProcessStats* stats = _process_stats();
+  if (stats != NULL && p->pid != -1) {
+    int64_t elapsed = _process_now_us() - start;
+    int bucket = 0;
+    while (bucket + 1 < PROCESS_STATS_BUCKETS &&
+        elapsed >= ((int64_t)2 << bucket)) {
+      bucket++;
+    }
+    _PROCESS_COUNTER_ADD(stats->spawns, 1);
+    _PROCESS_COUNTER_ADD(stats->latency[bucket], 1);
+  }
+  else if (stats != NULL) {
+    _PROCESS_COUNTER_ADD(stats->failures, 1);
+  }
+
+  return (p->pid != -1 ? 1 : 0);
+}
+
+/**
+ * @brief Process Lookup
+ *
+ * Resolves an executable name against a PATH, through the lookup cache
+ *
+ * @remarks
+ *  - A cached result is reused as long as none of the directories searched
+ *    to find it (those earlier in PATH could shadow it) has been modified;
+ *    they are checked on every hit, which costs one stat per directory
+ *    instead of a walk
+ *  - The PATH is walked and the directories are checked without holding
+ *    the cache lock
+ *
+ * @param name   The executable name (without a slash)
+ * @param search The PATH (colon-separated directories)
+ *
+ * @return The resolved path (owned by the caller), or NULL if not found
+ */
+char* _process_lookup(const char* name, const char* search) {
+  size_t hash = _process_env_hash(name, strlen(name));
+  struct ProcessLookupEntry** bucket =
+    &_process_lookup_cache[hash % _PROCESS_LOOKUP_BUCKETS];
+  char* path = NULL;
+
+  // Look for a cached result
+  size_t dirs = 0;
+  int64_t cached[_PROCESS_LOOKUP_DIRS];
+  pthread_mutex_lock(&_process_lookup_lock);
+  for (struct ProcessLookupEntry* e = *bucket; e != NULL; e = e->next) {
+    if (e->hash == hash && strcmp(e->name, name) == 0 &&
+        strcmp(e->search, search) == 0) {
+      _process_string_copy(&path, e->path);
+      dirs = e->dirs;
+      memcpy(cached, e->mtimes, dirs * sizeof(int64_t));
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_process_lookup_lock);
+
+  // Reuse it unless one of its directories has been modified
+  if (path != NULL) {
+    int64_t mtimes[_PROCESS_LOOKUP_DIRS];
+    if (_process_lookup_dirs(search, dirs, mtimes) == dirs &&
+        memcmp(mtimes, cached, dirs * sizeof(int64_t)) == 0) {
+      return path;
+    }
+    free(path);
+    path = NULL;
+  }
+
+  // Walk the PATH and cache the result
+  struct ProcessLookupEntry* entry = calloc(1, sizeof(*entry));
+  if (entry == NULL) {
+    return NULL;
+  }
+  path = _process_lookup_walk(name, search, &entry->dirs);
+  if (path == NULL || entry->dirs > _PROCESS_LOOKUP_DIRS ||
+      _process_lookup_dirs(search, entry->dirs, entry->mtimes) !=
+        entry->dirs) {
+    free(entry);
+    return path;
+  }
+  entry->hash = hash;
+  _process_string_copy(&entry->name, name);
+  _process_string_copy(&entry->search, search);
+  _process_string_copy(&entry->path, path);
+
+  pthread_mutex_lock(&_process_lookup_lock);
+  for (struct ProcessLookupEntry** e = bucket; *e != NULL; e = &(*e)->next) {
+    if ((*e)->hash == hash && strcmp((*e)->name, name) == 0 &&
+        strcmp((*e)->search, search) == 0) {
+      // Replace the stale entry
+      struct ProcessLookupEntry* stale = *e;
+      *e = stale->next;
+      free(stale->name);
+      free(stale->search);
+      free(stale->path);
+      free(stale);
+      break;
+    }
+  }
+  entry->next = *bucket;
+  *bucket     = entry;
+  pthread_mutex_unlock(&_process_lookup_lock);
+  return path;
+}
+
+/**
+ * @brief Process Lookup Directories
+ *
+ * Gets the modification times of the first directories of a PATH
+ *
+ * @param      search The PATH (colon-separated directories)
+ * @param      max    The number of directories
+ * @param[out] mtimes The modification times (-1 for a missing directory)
+ *
+ * @return The number of directories found in the PATH (at most max)
+ */
+size_t _process_lookup_dirs(const char* search, size_t max,
+    int64_t mtimes[]) {
+  size_t n = 0;
+  const char* dir = search;
+  while (n < max) {
+    const char* end = strchr(dir, ':');
+    size_t len = (end != NULL ? (size_t)(end - dir) : strlen(dir));
+    mtimes[n++] = _process_mtime(dir, len);
+    if (end == NULL) {
+      break;
+    }
+    dir = end + 1;
+  }
+  return n;
+}
+
+/**
+ * @brief Process Lookup Walk
+ *
+ * Searches the directories of a PATH for an executable
+ *
+ * @remarks
+ * An empty directory in PATH means the current directory
+ *
+ * @param      name   The executable name (without a slash)
+ * @param      search The PATH (colon-separated directories)
+ * @param[out] dirs   The number of directories searched
+ *
+ * @return The path of the executable (owned by the caller), or NULL
+ */
+char* _process_lookup_walk(const char* name, const char* search,
+    size_t* dirs) {
+  size_t name_len = strlen(name);
+  const char* dir = search;
+  *dirs = 0;
+  for (;;) {
+    const char* end = strchr(dir, ':');
+    size_t len = (end != NULL ? (size_t)(end - dir) : strlen(dir));
+    (*dirs)++;
+
+    // Check dir/name
+    char* path = malloc(len + name_len + 3);
+    if (path == NULL) {
+      return NULL;
+    }
+    if (len == 0) {
+      path[len++] = '.';
+    }
+    else {
+      memcpy(path, dir, len);
+    }
+    path[len] = '/';
+    memcpy(path + len + 1, name, name_len + 1);
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+        access(path, X_OK) == 0) {
+      return path;
+    }
+    free(path);
+
+    if (end == NULL) {
+      return NULL;
+    }
+    dir = end + 1;
+  }
+}
+
+/**
+ * @brief Process Modification Time
+ *
+ * Gets the modification time of a directory
+ *
+ * @param dir The directory (not NUL-terminated; empty for ".")
+ * @param len The length of the directory
+ *
+ * @return The modification time in nanoseconds, or -1 upon failure
+ */
+int64_t _process_mtime(const char* dir, size_t len) {
+  char buf[4096];
+  if (len >= sizeof(buf)) {
+    return -1;
+  }
+  if (len == 0) {
+    buf[len++] = '.';
+  }
+  else {
+    memcpy(buf, dir, len);
+  }
+  buf[len] = '\0';
+
+  struct stat st;
+  if (stat(buf, &st) != 0) {
+    return -1;
+  }
+#if defined(__APPLE__)
+  return (int64_t)st.st_mtimespec.tv_sec * 1000000000 +
+    st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+  return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+  return (int64_t)st.st_mtime * 1000000000;
+#endif
+}
+
+/**
+ * @brief Process Now
+ *
+ * Gets the current monotonic time
+ *
+ * @return The current monotonic time in milliseconds
+ */
+int64_t _process_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Process Now (microseconds)
+ *
+ * Gets the current monotonic time with microsecond resolution
+ *
+ * @return The current monotonic time in microseconds
+ */
+int64_t _process_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Process Node CPUs
+ *
+ * Lists the CPUs of a NUMA node from its sysfs cpulist (such as "0-3,8-11")
+ *
+ * @param      node The NUMA node
+ * @param[out] cpus The CPU numbers
+ * @param      max  The most CPU numbers to store
+ *
+ * @return The number of CPU numbers stored, or -1 if the node doesn't exist
+ */
+int _process_node_cpus(int node, int cpus[], int max) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+    node);
+  FILE* file = fopen(path, "re");
+  if (file == NULL) {
+    return -1;
+  }
+  char list[4096];
+  size_t len = fread(list, 1, sizeof(list) - 1, file);
+  fclose(file);
+  list[len] = '\0';
+
+  // Expand the ranges
+  int n = 0;
+  const char* pos = list;
+  while (*pos >= '0' && *pos <= '9' && n < max) {
+    char* end;
+    long lo = strtol(pos, &end, 10);
+    long hi = lo;
+    if (*end == '-') {
+      hi = strtol(end + 1, &end, 10);
+    }
+    for (long cpu = lo; cpu <= hi && n < max; cpu++) {
+      cpus[n++] = (int)cpu;
+    }
+    pos = (*end == ',' ? end + 1 : end);
+  }
+  return n;
+}
+
+/**
+ * @brief Process Null FD
+ *
+ * Gets the shared /dev/null fd, opening it on first use
+ *
+ * @remarks
+ * Threads racing to open it agree on one fd (the others close theirs)
+ *
+ * @return The fd, or -1 upon failure
+ */
+int _process_null_fd(void) {
+  int fd = _PROCESS_LOAD(_process_devnull);
+  if (fd == -1) {
+    int opened = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (opened != -1 && !_PROCESS_CAS(_process_devnull, fd, opened)) {
+      close(opened);
+      return fd;
+    }
+    fd = opened;
+  }
+  return fd;
+}
+
+/**
+ * @brief Process Path Set
+ *
+ * Copies a binary's path into a Process, reusing its storage when it fits
+ *
+ * @param[out] p    The Process object
+ * @param      path The path to the binary
+ *
+ * @return 1 upon success, 0 upon failure (the path is left unchanged)
+ */
+int _process_path_set(struct Process* p, const char* path) {
+  size_t len = strlen(path) + 1;
+  if (len > p->path_cap) {
+    char* copy = realloc(p->path, len);
+    if (copy == NULL) {
+      return 0;
+    }
+    p->path     = copy;
+    p->path_cap = len;
+  }
+  memcpy(p->path, path, len);
+  return 1;
+}
+
+/**
+ * @brief Process pidfd
+ *
+ * Gets a pidfd referring to the Process, opening it on first use
+ *
+ * @remarks
+ * Only a child that hasn't been reaped is opened by pid, since its pid can't
+ *   be reused until then; children of the zygote get their pidfd from the
+ *   zygote instead
+ *
+ * @param[out] p The Process object
+ *
+ * @return The pidfd, or -1 if pidfds aren't supported
+ */
+int _process_pidfd(struct Process* p) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  if (p->pidfd == -1 && p->pid != -1 && !p->exited && !p->zygote) {
+    p->pidfd = (int)syscall(SYS_pidfd_open, p->pid, 0);
+    if (p->pidfd != -1) {
+      fcntl(p->pidfd, F_SETFD, FD_CLOEXEC);
+      _PROCESS_STAT(fds_opened, 1);
+    }
+  }
+#endif
+  return p->pidfd;
+}
+
+/**
+ * @brief Process Pipe
+ *
+ * Creates a pipe whose ends are closed on exec
+ *
+ * @remarks
+ * Uses pipe2 where available so that no other thread can fork between the
+ *   creation of the pipe and setting FD_CLOEXEC; no fork lock is needed
+ *
+ * @param[out] fds The read and write ends of the pipe
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_pipe(int fds[2]) {
+#ifdef __linux__
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    return 0;
+  }
+#else
+  if (pipe(fds) != 0) {
+    return 0;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+  _PROCESS_STAT(fds_opened, 2);
+  return 1;
+}
+
+/**
+ * @brief Process Pipes Open
+ *
+ * Creates the stdin, stdout and stderr pipes for a Process
+ *
+ * @remarks
+ *  - Pipes are only created for streams wired with PROCESS_STDIO_PIPE; the
+ *    parent's end of every other stream is -1
+ *  - With PROCESS_OPTION_PTY, piped stdin and stdout get the pseudo-terminal
+ *    instead (stderr stays a pipe unless merged)
+ *  - Pipes are resized to the Process' pipe_size where F_SETPIPE_SZ exists
+ *    (a size the kernel refuses leaves the default capacity)
+ *  - The child's end of an inherited stream is -1, and a merged stderr gets
+ *    stdout's end (or STDOUT_FILENO if stdout is inherited)
+ *
+ * @param      p      The Process object
+ * @param[out] child  The pipe ends to become stdin, stdout and stderr
+ * @param[out] parent The pipe ends kept by the parent
+ *
+ * @return 1 upon success, 0 upon failure (no pipes are left open)
+ */
+int _process_pipes_open(struct Process* p, int child[3], int parent[3]) {
+  for (int i = 0; i < 3; i++) {
+    child[i]  = -1;
+    parent[i] = -1;
+  }
+  if ((p->options & PROCESS_OPTION_PTY) && !_process_pty_open(p, child,
+      parent)) {
+    return 0;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    int mode = _process_stdio_mode(p, i);
+    if (parent[i] != -1) {
+      // Already wired to the pseudo-terminal
+      continue;
+    }
+    if (mode == PROCESS_STDIO_PIPE) {
+      int fds[2];
+      if (_process_pipe(fds)) {
+        // The child reads stdin and writes stdout/stderr
+        child[i]  = (i == STDIN_FILENO ? fds[0] : fds[1]);
+        parent[i] = (i == STDIN_FILENO ? fds[1] : fds[0]);
+#ifdef F_SETPIPE_SZ
+        if (p->pipe_size[i] > 0) {
+          fcntl(fds[0], F_SETPIPE_SZ, p->pipe_size[i]);
+        }
+#endif
+      }
+    }
+    else if (mode == PROCESS_STDIO_NULL) {
+      child[i] = _process_null_fd();
+    }
+    else if (mode == PROCESS_STDIO_FD) {
+      child[i] = p->stdio_fd[i];
+    }
+    else if (mode == PROCESS_STDIO_MERGE) {
+      child[i] = (child[STDOUT_FILENO] != -1 ? child[STDOUT_FILENO] :
+        STDOUT_FILENO);
+    }
+    else {
+      continue;
+    }
+
+    if (child[i] == -1) {
+      for (int j = 0; j < i; j++) {
+        if (parent[j] != -1) {
+          close(child[j]);
+          close(parent[j]);
+        }
+      }
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Placement Apply
+ *
+ * Applies a CPU affinity and NUMA memory policy to the calling process
+ *
+ * @remarks
+ * Only called in the child; uses raw system calls (no libnuma)
+ *
+ * @param pl The placement
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_placement_apply(const struct ProcessPlacement* pl) {
+#ifdef __linux__
+  if (pl->has_cpus &&
+      syscall(SYS_sched_setaffinity, 0, sizeof(pl->cpus), pl->cpus) != 0) {
+    return 0;
+  }
+  if (pl->numa_mode != PROCESS_NUMA_DEFAULT &&
+      syscall(SYS_set_mempolicy, pl->numa_mode, pl->nodes,
+        _PROCESS_PLACE_NODES + 1) != 0) {
+    return 0;
+  }
+  return 1;
+#else
+  (void)pl;
+  return 0;
+#endif
+}
+
+/**
+ * @brief Process Placement Get
+ *
+ * Gets the placement of a Process, allocating it on first use
+ *
+ * @param[out] p The Process object
+ *
+ * @return The placement, or NULL upon failure
+ */
+struct ProcessPlacement* _process_placement_get(struct Process* p) {
+  if (p->placement == NULL) {
+    p->placement = calloc(1, sizeof(struct ProcessPlacement));
+  }
+  return p->placement;
+}
+
+/**
+ * @brief Process PTY Open
+ *
+ * Opens a pseudo-terminal for the piped stdin and stdout of a Process
+ *
+ * @remarks
+ *  - Each stream gets its own fds for the master (parent's end) and slave
+ *    (child's end), so they are closed independently, like pipes
+ *  - Echo and the output's newline translation are turned off, so the
+ *    child's output reads as it would through a pipe
+ *  - Streams that aren't piped are left alone (-1); if neither is piped, no
+ *    pseudo-terminal is opened
+ *
+ * @param      p      The Process object
+ * @param[out] child  The slave fds to become stdin and stdout
+ * @param[out] parent The master fds kept by the parent
+ *
+ * @return 1 upon success, 0 upon failure (no fds are left open)
+ */
+int _process_pty_open(struct Process* p, int child[3], int parent[3]) {
+  int first = -1;
+  for (int i = STDIN_FILENO; i <= STDOUT_FILENO; i++) {
+    if (_process_stdio_mode(p, i) != PROCESS_STDIO_PIPE) {
+      continue;
+    }
+    if (first == -1) {
+      // Open the master and unlock the slave
+      int flags = O_RDWR | O_NOCTTY;
+#ifdef O_CLOEXEC
+      flags |= O_CLOEXEC;
+#endif
+      int master = posix_openpt(flags);
+      if (master == -1) {
+        return 0;
+      }
+      fcntl(master, F_SETFD, FD_CLOEXEC);
+      const char* name = NULL;
+      int slave = -1;
+      if (grantpt(master) == 0 && unlockpt(master) == 0 &&
+          (name = ptsname(master)) != NULL) {
+        slave = open(name, flags);
+      }
+      if (slave == -1) {
+        int error = errno;
+        close(master);
+        errno = error;
+        return 0;
+      }
+      fcntl(slave, F_SETFD, FD_CLOEXEC);
+
+      // Pass the output through unaltered
+      struct termios tio;
+      if (tcgetattr(slave, &tio) == 0) {
+        tio.c_lflag &= ~(tcflag_t)(ECHO | ECHONL);
+        tio.c_oflag &= ~(tcflag_t)ONLCR;
+        tcsetattr(slave, TCSANOW, &tio);
+      }
+      parent[i] = master;
+      child[i]  = slave;
+      first     = i;
+      _PROCESS_STAT(fds_opened, 2);
+    }
+    else {
+      // Share the terminal through another pair of fds
+      parent[i] = fcntl(parent[first], F_DUPFD_CLOEXEC, 0);
+      child[i]  = fcntl(child[first], F_DUPFD_CLOEXEC, 0);
+      if (parent[i] == -1 || child[i] == -1) {
+        int error = errno;
+        for (int j = STDIN_FILENO; j <= i; j++) {
+          if (parent[j] != -1) {
+            close(parent[j]);
+          }
+          if (child[j] != -1) {
+            close(child[j]);
+          }
+          parent[j] = child[j] = -1;
+        }
+        errno = error;
+        return 0;
+      }
+      _PROCESS_STAT(fds_opened, 2);
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Read Full
+ *
+ * Reads exactly len bytes from a file descriptor
+ *
+ * @param      fd  The file descriptor
+ * @param[out] buf The destination buffer
+ * @param      len The number of bytes to read
+ *
+ * @return 1 upon success, 0 upon failure or early EOF
+ */
+int _process_read_full(int fd, void* buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t count = read(fd, (char*)buf + done, len - done);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return 0;
+    }
+    done += (size_t)count;
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Reap
+ *
+ * Collects the exit status and resource usage of the Process
+ *
+ * @remarks
+ *  - Invokes the exit callback once the Process is reaped
+ *  - Children of the zygote are reaped by the zygote, which writes their
+ *    wait status and resource usage to their exit pipe; if the zygote went
+ *    away first, they are marked as exited with a status of -1 once their
+ *    pidfd reports the exit (without pidfd support, once their pid is gone,
+ *    which can't tell a reused pid apart)
+ *
+ * @param[out] p     The Process object
+ * @param      block 1 to wait for the Process to exit, 0 to return at once
+ *
+ * @return 1 if the Process has been reaped, 0 otherwise
+ */
+int _process_reap(struct Process* p, int block) {
+  if (p->pid == -1 || p->exited) {
+    return p->exited;
+  }
+
+  // Collect the exit status
+  int status = 0;
+  struct rusage usage;
+  memset(&usage, 0, sizeof(usage));
+  pid_t pid;
+  do {
+    pid = wait4(p->pid, &status, (block ? 0 : WNOHANG), &usage);
+  } while (pid == -1 && errno == EINTR);
+  int foreign = (pid == -1 && errno == ECHILD);
+  if (foreign && p->exit_fd != -1) {
+    // A child of the zygote: once it has exited (as its pidfd tells), the
+    //   zygote reports it right away
+    int timeout = (block ? -1 : 0);
+    struct pollfd pfd = { p->pidfd, POLLIN, 0 };
+    if (!block && pfd.fd != -1 && poll(&pfd, 1, 0) > 0) {
+      timeout = -1;
+    }
+    pfd.fd = p->exit_fd;
+    int ready;
+    do {
+      ready = poll(&pfd, 1, timeout);
+    } while (ready == -1 && errno == EINTR);
+    if (ready > 0) {
+      struct ProcessZygoteExit report;
+      if (_process_read_full(p->exit_fd, &report, sizeof(report))) {
+        pid    = p->pid;
+        status = report.status;
+        usage  = report.usage;
+      }
+      // Otherwise the zygote went away: watch the child itself
+      close(p->exit_fd);
+      p->exit_fd = -1;
+    }
+  }
+  if (foreign && pid != p->pid && p->exit_fd == -1 && p->pidfd != -1) {
+    // Not our child: its pidfd becomes readable once it exits
+    struct pollfd pfd = { p->pidfd, POLLIN, 0 };
+    int ready;
+    do {
+      ready = poll(&pfd, 1, (block ? -1 : 0));
+    } while (ready == -1 && errno == EINTR);
+    if (ready > 0) {
+      pid    = p->pid;
+      status = -1;
+    }
+  }
+  else if (foreign && pid != p->pid && p->exit_fd == -1) {
+    // Not our child and no pidfd: wait for it to disappear
+    while (block && kill(p->pid, 0) == 0) {
+      _process_wait_exit(p, -1);
+    }
+    if (kill(p->pid, 0) == -1 && errno == ESRCH) {
+      pid    = p->pid;
+      status = -1;
+    }
+  }
+  if (pid != p->pid) {
+    return 0;
+  }
+  p->exited   = 1;
+  p->status   = status;
+  p->usage    = usage;
+  p->deadline = 0;
+  _PROCESS_STAT(reaped, 1);
+
+  // Stop watching for the exit and release the pidfd and exit pipe
+  struct ProcessWatch* w = p->watch;
+  if (w != NULL) {
+    _process_watch_stream_remove(&w->streams[_PROCESS_STREAM_EXIT]);
+    if (w->sweep) {
+      w->sweep = 0;
+      w->group->sweeps--;
+    }
+  }
+  if (p->pidfd != -1) {
+    close(p->pidfd);
+    p->pidfd = -1;
+  }
+  if (p->exit_fd != -1) {
+    close(p->exit_fd);
+    p->exit_fd = -1;
+  }
+
+  if (p->exit_callback != NULL) {
+    p->exit_callback(p, p->exit_data);
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Reset
+ *
+ * Returns a Process object to the state process_create leaves it in, keeping
+ *   the storage that can be reused
+ *
+ * @remarks
+ *  - The path buffer, argument and environment arenas and pointer vectors,
+ *    environment index, extra fd and resource limit arrays, stdin feed ring
+ *    and capture buffers (up to _PROCESS_CACHE_BUFFER bytes) are kept, empty
+ *  - The watch, pidfd, cgroup fd, placement and environment template are
+ *    released; the stdio fds are left alone, as process_free does
+ *
+ * @param[out] p The Process object
+ */
+void _process_reset(struct Process* p) {
+  // Release what can't be reused
+  if (p->service != NULL) {
+    _process_service_detach(p->service);
+  }
+  if (p->watch != NULL) {
+    _process_watch_remove(p->watch);
+  }
+  if (p->pidfd != -1) {
+    close(p->pidfd);
+  }
+  if (p->exit_fd != -1) {
+    close(p->exit_fd);
+  }
+  _process_feed_drop(p);
+  _process_env_template_drop(p->env_template);
+  if (p->cgroup_fd != -1) {
+    close(p->cgroup_fd);
+  }
+  free(p->placement);
+
+  // Empty the storage kept for reuse
+  if (p->path != NULL) {
+    p->path[0] = '\0';
+  }
+  _process_array_reset(p->argv, &p->argc, &p->argv_arena);
+  _process_array_reset(p->envp, &p->envc, &p->envp_arena);
+  _process_env_index_reset(&p->env_index);
+  for (int i = 0; i < 3; i++) {
+    struct ProcessCapture* c = &p->capture[i];
+    if (c->cap > _PROCESS_CACHE_BUFFER) {
+      free(c->data);
+      c->data = NULL;
+      c->cap  = 0;
+    }
+    c->mode  = PROCESS_CAPTURE_NONE;
+    c->start = 0;
+    c->len   = 0;
+    c->limit = 0;
+  }
+  p->fd_count     = 0;
+  p->rlimit_count = 0;
+
+  // Restore the defaults
+  p->in   = -1;
+  p->out  = -1;
+  p->err  = -1;
+  p->pid  = -1;
+  p->error = 0;
+  p->engine = PROCESS_ENGINE_DEFAULT;
+  p->options = 0;
+  p->env_template = NULL;
+  p->env_dirty    = 0;
+  p->watch = NULL;
+  p->pidfd  = -1;
+  p->zygote = 0;
+  p->exit_fd = -1;
+  p->exited = 0;
+  p->status = 0;
+  memset(&p->usage, 0, sizeof(p->usage));
+  p->exit_callback = NULL;
+  p->exit_data     = NULL;
+  p->deadline      = 0;
+  for (int i = 0; i < 3; i++) {
+    p->stdio[i]     = PROCESS_STDIO_PIPE;
+    p->stdio_fd[i]  = -1;
+    p->pipe_size[i] = 0;
+  }
+  p->cgroup_fd = -1;
+  p->placement = NULL;
+  p->pgid      = -1;
+  p->service   = NULL;
+}
+
+/**
+ * @brief Process Service Detach
+ *
+ * Stops supervising a Process and frees its supervision state
+ *
+ * @remarks
+ * The Process' own exit callback is restored; the Process is left as it is
+ *
+ * @param[out] svc The supervision state
+ */
+void _process_service_detach(struct ProcessService* svc) {
+  struct ProcessSupervisor* s = svc->sup;
+  _process_service_unqueue(svc);
+  if (svc->prev != NULL) {
+    svc->prev->next = svc->next;
+  }
+  else {
+    s->head = svc->next;
+  }
+  if (svc->next != NULL) {
+    svc->next->prev = svc->prev;
+  }
+  svc->p->exit_callback = svc->exit_callback;
+  svc->p->exit_data     = svc->exit_data;
+  svc->p->service       = NULL;
+  free(svc);
+}
+
+/**
+ * @brief Process Service Exit
+ *
+ * Exit callback of a supervised Process: schedules its restart according to
+ *   its policy, then calls the Process' own exit callback
+ *
+ * @remarks
+ * Runs wherever the Process is reaped (process_supervisor_poll, or any
+ *   process_wait); the restart itself is launched by process_supervisor_poll
+ *
+ * @param[out] p    The Process object
+ * @param      data The supervision state
+ */
+void _process_service_exit(struct Process* p, void* data) {
+  struct ProcessService* svc = data;
+  struct ProcessSupervisor* s = svc->sup;
+  ProcessExitCallback callback = svc->exit_callback;
+  void* callback_data = svc->exit_data;
+
+  // Decide whether to restart the Process
+  int success = (p->status != -1 && WIFEXITED(p->status) &&
+    WEXITSTATUS(p->status) == 0);
+  int restart = (svc->policy == PROCESS_RESTART_ALWAYS ||
+    (svc->policy == PROCESS_RESTART_ON_FAILURE && !success));
+  if (restart && !_process_service_retry(svc, _process_now())) {
+    restart = 0;
+  }
+  if (!restart) {
+    _process_service_detach(svc);
+  }
+
+  if (callback != NULL) {
+    callback(p, callback_data);
+  }
+  if (!restart && s->callback != NULL) {
+    s->callback(p, PROCESS_SUPERVISE_STOPPED, s->data);
+  }
+}
+
+/**
+ * @brief Process Service Queue
+ *
+ * Schedules the restart of a supervised Process
+ *
+ * @remarks
+ * A restart already due goes straight to the due list; any other waits in
+ *   the timer wheel slot of its due time
+ *
+ * @param[out] svc The supervision state
+ * @param      due When the restart is due (monotonic ms)
+ */
+void _process_service_queue(struct ProcessService* svc, int64_t due) {
+  struct ProcessSupervisor* s = svc->sup;
+  _process_service_unqueue(svc);
+  struct ProcessService** head = &s->due;
+  svc->due    = due;
+  svc->queued = 2;
+  if (due > s->wheel_now) {
+    head = &s->wheel[due % _PROCESS_WHEEL_SLOTS];
+    svc->queued = 1;
+    s->timers++;
+  }
+  svc->qprev = NULL;
+  svc->qnext = *head;
+  if (*head != NULL) {
+    (*head)->qprev = svc;
+  }
+  *head = svc;
+}
+
+/**
+ * @brief Process Service Retry
+ *
+ * Schedules another launch of a supervised Process, if its restart limit
+ *   allows
+ *
+ * @remarks
+ *  - max_restarts restarts are allowed per window (over the Process'
+ *    lifetime when window is 0)
+ *  - The delay doubles after each restart, from the supervisor's minimum up
+ *    to its maximum, and starts over once a launch has lasted longer than
+ *    the maximum
+ *
+ * @param[out] svc The supervision state
+ * @param      now The current monotonic time (ms)
+ *
+ * @return 1 if the launch was scheduled, 0 if the limit was reached
+ */
+int _process_service_retry(struct ProcessService* svc, int64_t now) {
+  struct ProcessSupervisor* s = svc->sup;
+
+  // Count the restart in its window
+  if (svc->window > 0 && now - svc->window_start >= svc->window) {
+    svc->window_start = now;
+    svc->window_count = 0;
+  }
+  if (svc->max_restarts > 0 && svc->window_count >= svc->max_restarts) {
+    return 0;
+  }
+  svc->window_count++;
+
+  // Back off exponentially
+  if (now - svc->started >= s->backoff_max) {
+    svc->backoff = s->backoff_min;
+  }
+  int delay = svc->backoff;
+  svc->backoff = (delay > s->backoff_max / 2 ? s->backoff_max :
+    (delay > 0 ? delay * 2 : 1));
+  _process_service_queue(svc, now + delay);
+  return 1;
+}
+
+/**
+ * @brief Process Service Unqueue
+ *
+ * Cancels the pending restart of a supervised Process (if any)
+ *
+ * @param[out] svc The supervision state
+ */
+void _process_service_unqueue(struct ProcessService* svc) {
+  struct ProcessSupervisor* s = svc->sup;
+  if (svc->queued == 0) {
+    return;
+  }
+  if (svc->qprev != NULL) {
+    svc->qprev->qnext = svc->qnext;
+  }
+  else if (svc->queued == 1) {
+    s->wheel[svc->due % _PROCESS_WHEEL_SLOTS] = svc->qnext;
+  }
+  else {
+    s->due = svc->qnext;
+  }
+  if (svc->qnext != NULL) {
+    svc->qnext->qprev = svc->qprev;
+  }
+  if (svc->queued == 1) {
+    s->timers--;
+  }
+  svc->queued = 0;
+  svc->qprev  = NULL;
+  svc->qnext  = NULL;
+}
+
+/**
+ * @brief Process Signal
+ *
+ * Sends a signal to the Process' process group
+ *
+ * @remarks
+ *  - Every engine makes the child the leader of its own process group
+ *    (unless it joins another with process_set_pgid), so this reaches its
+ *    descendants too; falls back to the Process alone
+ *  - A child of the zygote is signalled alone, through its pidfd: the zygote
+ *    reaps it, so its pid (and process group) may already have been reused
+ *
+ * @param p   The Process object
+ * @param sig The signal to send
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_signal(struct Process* p, int sig) {
+  if (p->pid == -1 || p->exited) {
+    return 0;
+  }
+#if defined(__linux__) && defined(SYS_pidfd_send_signal)
+  if (p->zygote && p->pidfd != -1) {
+    return (syscall(SYS_pidfd_send_signal, p->pidfd, sig, NULL, 0) == 0);
+  }
+#endif
+  if (kill(-p->pid, sig) == 0 || kill(p->pid, sig) == 0) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Process Slab Get
+ *
+ * Takes a buffer from a ProcessGroup's slab pool, allocating one if the pool
+ *   is empty
+ *
+ * @param[out] g The ProcessGroup
+ *
+ * @return The buffer, or NULL upon failure
+ */
+struct ProcessSlab* _process_slab_get(struct ProcessGroup* g) {
+  struct ProcessSlab* slab = g->slabs;
+  if (slab != NULL) {
+    g->slabs = slab->next;
+    return slab;
+  }
+  return malloc(sizeof(struct ProcessSlab));
+}
+
+/**
+ * @brief Process Spawn
+ *
+ * Launches the Process with its selected engine
+ *
+ * @remarks
+ *  - A Process with a cgroup is launched with clone3 where the kernel
+ *    supports CLONE_INTO_CGROUP, so it never runs outside of its cgroup
+ *  - fork and vfork children report a failed execve through a close-on-exec
+ *    error pipe, so the launch fails at once; posix_spawn and the zygote
+ *    report it themselves
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent
+ *
+ * @return The pid of the new process, or -1 upon failure
+ */
+pid_t _process_spawn(struct Process* p, const int child[3],
+    const int parent[3]) {
+  pid_t pid = -1;
+  int engine = _process_engine(p);
+
+  // Create the error pipe of a fork or vfork child
+  int report[2] = { -1, -1 };
+  if ((engine == PROCESS_ENGINE_FORK || engine == PROCESS_ENGINE_VFORK) &&
+      !_process_pipe(report)) {
+    return -1;
+  }
+
+#ifdef __linux__
+  if (p->cgroup_fd != -1) {
+    pid = _process_spawn_clone3(p, child, parent, report[1]);
+    if (pid != -1 || (errno != ENOSYS && errno != E2BIG && errno != EINVAL)) {
+      return _process_exec_wait(p, pid, report);
+    }
+  }
+#endif
+  switch (engine) {
+    case PROCESS_ENGINE_SPAWN:
+      pid = _process_spawn_posix(p, child, parent);
+      break;
+    case PROCESS_ENGINE_VFORK:
+      pid = _process_spawn_vfork(p, child, parent, report[1]);
+      break;
+    case PROCESS_ENGINE_ZYGOTE:
+      pid = _process_spawn_zygote(p, child, parent);
+      p->zygote = (pid != -1);
+      break;
+    default:
+      pid = _process_spawn_fork(p, child, parent, report[1]);
+      break;
+  }
+  return _process_exec_wait(p, pid, report);
+}
+
+/**
+ * @brief Process Spawn (clone3)
+ *
+ * Launches the Process via clone3, placing it in its cgroup atomically
+ *
+ * @remarks
+ *  - Forks (the address space is copied, as with fork) and also receives
+ *    the pidfd of the child, saving a pidfd_open later
+ *  - Fails with ENOSYS where clone3 or CLONE_INTO_CGROUP isn't supported
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent
+ * @param report The write end of the error pipe
+ *
+ * @return The pid of the new process, or -1 upon failure
+ */
+pid_t _process_spawn_clone3(struct Process* p, const int child[3],
+    const int parent[3], int report) {
+#if defined(__linux__) && defined(SYS_clone3)
+  int pidfd = -1;
+  struct ProcessCloneArgs args;
+  memset(&args, 0, sizeof(args));
+  args.flags       = CLONE_INTO_CGROUP | CLONE_PIDFD;
+  args.pidfd       = (uint64_t)(uintptr_t)&pidfd;
+  args.exit_signal = SIGCHLD;
+  args.cgroup      = (uint64_t)p->cgroup_fd;
+
+  // Fork into the cgroup and exec
+  pid_t pid = (pid_t)syscall(SYS_clone3, &args, sizeof(args));
+  if (pid == 0) {
+    _process_child_exec(p, child, parent, report);
+  }
+  if (pid > 0) {
+    _PROCESS_STAT(fds_opened, 1);
+    if (p->pidfd == -1) {
+      p->pidfd = pidfd;
+    }
+    else {
+      close(pidfd);
+    }
+  }
+  return pid;
+#else
+  (void)p;
+  (void)child;
+  (void)parent;
+  (void)report;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/**
+ * @brief Process Spawn (fork)
+ *
+ * Launches the Process via fork/exec
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent
+ * @param report The write end of the error pipe
+ *
+ * @return The pid of the new process, or -1 upon failure
+ */
+pid_t _process_spawn_fork(struct Process* p, const int child[3],
+    const int parent[3], int report) {
+  // Fork and exec
+  pid_t pid = fork();
+  if (pid == 0) {
+    _process_child_cgroup(p, report);
+    _process_child_exec(p, child, parent, report);
+  }
+  return pid;
+}
+
+/**
+ * @brief Process Spawn (posix_spawn)
+ *
+ * Launches the Process via posix_spawn, wiring the pipes with file actions
+ *
+ * @remarks
+ *  - The child gets its own session where POSIX_SPAWN_SETSID is supported,
+ *    and its own process group otherwise (or joins the Process' pgid)
+ *  - Where POSIX_SPAWN_CLOEXEC_DEFAULT is supported (macOS), the child only
+ *    inherits its stdio fds; with glibc 2.34+ the others are closed with
+ *    posix_spawn_file_actions_addclosefrom_np
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent
+ *
+ * @return The pid of the new process, or -1 upon failure
+ */
+pid_t _process_spawn_posix(struct Process* p, const int child[3],
+    const int parent[3]) {
+  pid_t pid = -1;
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+
+  // Prepare pipes
+  posix_spawn_file_actions_init(&actions);
+  for (int i = 0; i < 3; i++) {
+    if (parent[i] != -1) {
+      posix_spawn_file_actions_addclose(&actions, parent[i]);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    if (child[i] != -1 && child[i] != i) {
+      posix_spawn_file_actions_adddup2(&actions, child[i], i);
+    }
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+    else {
+      posix_spawn_file_actions_addinherit_np(&actions, i);
+    }
+#endif
+  }
+  for (int i = 0; i < 3; i++) {
+    // Close each fd once (stderr may share stdout's)
+    if (child[i] > STDERR_FILENO && (i == 0 || child[i] != child[i - 1]) &&
+        (i < 2 || child[i] != child[0])) {
+      posix_spawn_file_actions_addclose(&actions, child[i]);
+    }
+  }
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 34)
+  if (!(p->options & PROCESS_OPTION_INHERIT_FDS)) {
+    posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+  }
+#endif
+
+  // Create session and process group
+  posix_spawnattr_init(&attr);
+  short flags = 0;
+  if (p->pgid != -1) {
+    flags |= POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setpgroup(&attr, p->pgid);
+  }
+  else {
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#else
+    flags |= POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setpgroup(&attr, 0);
+#endif
+  }
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+  // Without pipe2 another thread's fds may not be close-on-exec yet, so only
+  //   pass the fds named by the file actions
+  flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#endif
+  posix_spawnattr_setflags(&attr, flags);
+
+  // Run command (a failed exec is reported by posix_spawn's return value)
+  int error = posix_spawn(&pid, p->path, &actions, &attr, p->argv,
+    _process_environ(p));
+  if (error != 0) {
+    pid   = -1;
+    errno = error;
+  }
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  return pid;
+}
+
+/**
+ * @brief Process Spawn (vfork)
+ *
+ * Launches the Process via vfork/exec
+ *
+ * @remarks
+ * The parent is suspended until the child execs or exits, but nothing is
+ *   copied, so the cost doesn't grow with the size of the parent
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent
+ * @param report The write end of the error pipe
+ *
+ * @return The pid of the new process, or -1 upon failure
+ */
+pid_t _process_spawn_vfork(struct Process* p, const int child[3],
+    const int parent[3], int report) {
+  // Fork and exec
+  pid_t pid = vfork();
+  if (pid == 0) {
+    _process_child_cgroup(p, report);
+    _process_child_exec(p, child, parent, report);
+  }
+  return pid;
+}
+
+/**
+ * @brief Process Spawn (zygote)
+ *
+ * Asks the zygote helper to fork and exec the Process
+ *
+ * @remarks
+ *  - Fails if the zygote hasn't been started with process_zygote_start
+ *  - The new process is a child of the zygote, so the zygote reaps it; the
+ *    zygote opens its pidfd before it can be reaped and passes it back, so
+ *    the Process is watched and signalled through it, along with a pipe it
+ *    reports the exit status through
+ *  - Requests from many threads are serialized on the zygote socket; the
+ *    request is serialized before the lock is taken
+ *
+ * @param p      The Process object
+ * @param child  The pipe ends to become stdin, stdout and stderr
+ * @param parent The pipe ends kept by the parent (unused)
+ *
+ * @return The pid of the new process, or -1 upon failure
+ */
+pid_t _process_spawn_zygote(struct Process* p, const int child[3],
+    const int parent[3]) {
+  (void)parent;
+
+  // Serialize path, argv and envp into a single block
+  char** envp = _process_environ(p);
+  size_t argc = p->argc;
+  size_t envc = (size_t)_process_array_count(envp);
+  size_t size = strlen(p->path) + 1;
+  for (size_t i = 0; i < argc; i++) {
+    size += strlen(p->argv[i]) + 1;
+  }
+  for (size_t i = 0; i < envc; i++) {
+    size += strlen(envp[i]) + 1;
+  }
+  char* block = malloc(size);
+  if (block == NULL) {
+    return -1;
+  }
+  char* pos = block;
+  size_t len = strlen(p->path) + 1;
+  memcpy(pos, p->path, len);
+  pos += len;
+  for (size_t i = 0; i < argc; i++) {
+    len = strlen(p->argv[i]) + 1;
+    memcpy(pos, p->argv[i], len);
+    pos += len;
+  }
+  for (size_t i = 0; i < envc; i++) {
+    len = strlen(envp[i]) + 1;
+    memcpy(pos, envp[i], len);
+    pos += len;
+  }
+
+  // Send the header with the stdio fds attached
+  struct ProcessZygoteRequest request = { (uint32_t)size, (uint32_t)argc,
+    (uint32_t)envc };
+  union {
+    struct cmsghdr header;
+    char           space[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct iovec iov = { &request, sizeof(request) };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.space;
+  msg.msg_controllen = sizeof(control.space);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN(3 * sizeof(int));
+  int fds[3];
+  for (int i = 0; i < 3; i++) {
+    // The zygote's own streams are stale, so pass inherited streams on
+    fds[i] = (child[i] != -1 ? child[i] : i);
+  }
+  memcpy(CMSG_DATA(cmsg), fds, 3 * sizeof(int));
+
+  int flags = 0;
+#ifdef MSG_NOSIGNAL
+  flags = MSG_NOSIGNAL;
+#endif
+  struct ProcessZygoteReply reply = { -1, 0, 0 };
+  int attached[2] = { -1, -1 };
+  pthread_mutex_lock(&_process_zygote_lock);
+  int zfd = _process_zygote_fd;
+  ssize_t sent = -1;
+  if (zfd != -1) {
+    do {
+      sent = sendmsg(zfd, &msg, flags);
+    } while (sent < 0 && errno == EINTR);
+  }
+
+  // Send the rest of the request and wait for the reply
+  if (sent > 0 &&
+      _process_write_full(zfd, (char*)&request + sent,
+        sizeof(request) - (size_t)sent) &&
+      _process_write_full(zfd, block, size) &&
+      _process_zygote_receive(zfd, &reply, attached)) {
+    if (reply.pid == -1) {
+      errno = reply.error;
+    }
+  }
+  pthread_mutex_unlock(&_process_zygote_lock);
+
+  // Keep the exit pipe and the pidfd
+  int* keep[2] = { &p->exit_fd, &p->pidfd };
+  for (int i = 0; i < 2; i++) {
+    if (attached[i] == -1) {
+      continue;
+    }
+    _PROCESS_STAT(fds_opened, 1);
+    if (reply.pid != -1 && *keep[i] == -1) {
+      *keep[i] = attached[i];
+    }
+    else {
+      close(attached[i]);
+    }
+  }
+  free(block);
+  return reply.pid;
+}
+
+/**
+ * @brief Process Statistics
+ *
+ * Gets the calling thread's statistics counters, allocating them on first use
+ *
+ * @remarks
+ * Each thread only ever adds to its own counters, so counting needs no lock
+ *   or atomic read-modify-write; the lock is taken once per thread, to link
+ *   the counters where process_get_stats can find them
+ *
+ * @return The thread's counters, or NULL if they couldn't be allocated
+ */
+struct ProcessStats* _process_stats(void) {
+  pthread_once(&_process_stats_once, _process_stats_init);
+  if (!_process_stats_ready) {
+    return NULL;
+  }
+  struct ProcessStatsSlot* slot = pthread_getspecific(_process_stats_key);
+  if (slot == NULL) {
+    slot = calloc(1, sizeof(struct ProcessStatsSlot));
+    if (slot == NULL) {
+      return NULL;
+    }
+    if (pthread_setspecific(_process_stats_key, slot) != 0) {
+      free(slot);
+      return NULL;
+    }
+    pthread_mutex_lock(&_process_stats_lock);
+    slot->next = _process_stats_head;
+    if (slot->next != NULL) {
+      slot->next->prev = slot;
+    }
+    _process_stats_head = slot;
+    pthread_mutex_unlock(&_process_stats_lock);
+  }
+  return &slot->stats;
+}
+
+/**
+ * @brief Process Statistics Exit
+ *
+ * Folds the counters of an exiting thread into the retired totals
+ *
+ * @param slot The thread's counters (a struct ProcessStatsSlot)
+ */
+void _process_stats_exit(void* slot) {
+  struct ProcessStatsSlot* s = slot;
+  pthread_mutex_lock(&_process_stats_lock);
+  _process_stats_merge(&_process_stats_retired, &s->stats);
+  if (s->prev != NULL) {
+    s->prev->next = s->next;
+  }
+  else {
+    _process_stats_head = s->next;
+  }
+  if (s->next != NULL) {
+    s->next->prev = s->prev;
+  }
+  pthread_mutex_unlock(&_process_stats_lock);
+  free(s);
+}
+
+/**
+ * @brief Process Statistics Initialize
+ *
+ * Creates the thread-specific key of the statistics counters (run once)
+ */
+void _process_stats_init(void) {
+  _process_stats_ready = (pthread_key_create(&_process_stats_key,
+    _process_stats_exit) == 0);
+}
+
+/**
+ * @brief Process Statistics Merge
+ *
+ * Adds one set of counters to another
+ *
+ * @param[out] dst The counters to add to
+ * @param      src The counters to add (possibly being updated by their
+ *                 thread)
+ */
+void _process_stats_merge(struct ProcessStats* dst,
+    struct ProcessStats* src) {
+  dst->spawns     += _PROCESS_COUNTER_READ(src->spawns);
+  dst->failures   += _PROCESS_COUNTER_READ(src->failures);
+  dst->fds_opened += _PROCESS_COUNTER_READ(src->fds_opened);
+  dst->bytes_read += _PROCESS_COUNTER_READ(src->bytes_read);
+  dst->reaped     += _PROCESS_COUNTER_READ(src->reaped);
+  for (int i = 0; i < PROCESS_STATS_BUCKETS; i++) {
+    dst->latency[i] += _PROCESS_COUNTER_READ(src->latency[i]);
+  }
+}
+
+/**
+ * @brief Process Statistics Total
+ *
+ * Sums the counters of every thread, running or exited
+ *
+ * @remarks
+ * Called with the statistics lock held
+ *
+ * @param[out] total The sum of the counters
+ */
+void _process_stats_total(struct ProcessStats* total) {
+  memset(total, 0, sizeof(struct ProcessStats));
+  _process_stats_merge(total, &_process_stats_retired);
+  for (struct ProcessStatsSlot* s = _process_stats_head; s != NULL;
+      s = s->next) {
+    _process_stats_merge(total, &s->stats);
+  }
+}
+
+/**
+ * @brief Process Stdio Mode
+ *
+ * Gets how one of the Process' standard streams is wired at launch
+ *
+ * @remarks
+ * A stream captured with PROCESS_CAPTURE_DISCARD is wired to /dev/null
+ *
+ * @param p      The Process object
+ * @param stream The stream (one of PROCESS_STREAM_*)
+ *
+ * @return The wiring (one of PROCESS_STDIO_*)
+ */
+int _process_stdio_mode(struct Process* p, int stream) {
+  if (p->capture[stream].mode == PROCESS_CAPTURE_DISCARD) {
+    return PROCESS_STDIO_NULL;
+  }
+  return p->stdio[stream];
+}
+
+/**
+ * @brief Process Stream FD
+ *
+ * Gets the parent's fd for one of the Process' standard streams
+ *
+ * @param p      The Process object
+ * @param stream The stream (one of PROCESS_STREAM_*)
+ *
+ * @return The fd, or -1 if the stream isn't open
+ */
+int _process_stream_fd(struct Process* p, int stream) {
+  switch (stream) {
+    case PROCESS_STREAM_IN:
+      return p->in;
+    case PROCESS_STREAM_OUT:
+      return p->out;
+    case PROCESS_STREAM_ERR:
+      return p->err;
+  }
+  return -1;
+}
+
+/**
+ * @brief Process String Copy
+ *
+ * Copies a string into another location
+ *
+ * @remarks
+ * Allocates new storage for destination
+ *
+ * @param[out] dest The destination pointer
+ * @param      src  The source string
+ */
+void _process_string_copy(char** dest, const char* src) {
+  // Allocate space for src at dest
+  *dest = calloc(strlen(src) + 1, sizeof(char));
+  // Copy src to dest
+  memcpy(*dest, src, strlen(src));
+}
+
+/**
+ * @brief Process Supervisor Advance
+ *
+ * Moves the restarts that have come due from the timer wheel to the due list
+ *
+ * @remarks
+ * Visits each slot between the wheel's time and now once (every slot at
+ *   most), so a late poll costs at most one turn of the wheel
+ *
+ * @param[out] s   The ProcessSupervisor
+ * @param      now The current monotonic time (ms)
+ */
+void _process_supervisor_advance(struct ProcessSupervisor* s, int64_t now) {
+  int64_t from = s->wheel_now;
+  if (now <= from) {
+    return;
+  }
+  s->wheel_now = now;
+  int64_t ticks = now - from;
+  if (ticks > _PROCESS_WHEEL_SLOTS) {
+    ticks = _PROCESS_WHEEL_SLOTS;
+  }
+  for (int64_t t = 1; t <= ticks && s->timers > 0; t++) {
+    struct ProcessService* svc = s->wheel[(from + t) % _PROCESS_WHEEL_SLOTS];
+    while (svc != NULL) {
+      struct ProcessService* next = svc->qnext;
+      if (svc->due <= now) {
+        _process_service_queue(svc, svc->due);
+      }
+      svc = next;
+    }
+  }
+}
+
+/**
+ * @brief Process Supervisor Timeout
+ *
+ * Shortens a poll timeout so that it ends when the next restart is due
+ *
+ * @remarks
+ * Looks ahead at most one turn of the wheel; a restart due later than that
+ *   wakes the poll once per turn
+ *
+ * @param s       The ProcessSupervisor
+ * @param timeout The requested timeout (ms, or -1 for none)
+ *
+ * @return The timeout to poll with (ms, or -1 for none)
+ */
+int _process_supervisor_timeout(struct ProcessSupervisor* s, int timeout) {
+  if (s->due != NULL) {
+    return 0;
+  }
+  if (s->timers == 0) {
+    return timeout;
+  }
+  int64_t now = _process_now();
+  int left = _PROCESS_WHEEL_SLOTS;
+  for (int t = 1; t <= _PROCESS_WHEEL_SLOTS && left == _PROCESS_WHEEL_SLOTS;
+      t++) {
+    int64_t tick = s->wheel_now + t;
+    for (struct ProcessService* svc = s->wheel[tick % _PROCESS_WHEEL_SLOTS];
+        svc != NULL; svc = svc->qnext) {
+      if (svc->due <= tick) {
+        left = (int)(tick - now);
+        break;
+      }
+    }
+  }
+  if (left < 0) {
+    left = 0;
+  }
+  return (timeout < 0 || left < timeout ? left : timeout);
+}
+
+/**
+ * @brief Process Trace
+ *
+ * Calls the trace hook (if one is set) as a phase of a launch begins or ends
+ *
+ * @param p     The Process object being launched
+ * @param phase The phase (one of PROCESS_PHASE_*)
+ * @param end   0 as the phase begins, 1 once it ends
+ */
+void _process_trace(struct Process* p, int phase, int end) {
+  ProcessTraceCallback hook = _PROCESS_LOAD(_process_trace_hook);
+  if (hook != NULL) {
+    // Keep the phase's errno for the launch
+    int error = errno;
+    hook(p, phase, end, _PROCESS_LOAD(_process_trace_data));
+    errno = error;
+  }
+}
+
+/**
+ * @brief Process Wait Exit
+ *
+ * Sleeps until the Process exits or the timeout expires, without reaping
+ *
+ * @remarks
+ * Uses the pidfd where available and sleeps in short steps otherwise
+ *
+ * @param[out] p       The Process object
+ * @param      timeout The maximum time to wait in milliseconds (-1 for no
+ *                     limit)
+ */
+void _process_wait_exit(struct Process* p, int timeout) {
+#ifdef __linux__
+  struct pollfd pfd = { _process_pidfd(p), POLLIN, 0 };
+  if (pfd.fd != -1 && poll(&pfd, 1, timeout) != -1) {
+    return;
+  }
+#else
+  (void)p;
+#endif
+  usleep((useconds_t)((timeout >= 0 && timeout < 10 ? timeout : 10) * 1000));
+}
+
+/**
+ * @brief Process Watch Remove
+ *
+ * Stops watching a Process and releases its registration
+ *
+ * @remarks
+ * While the group is dispatching events the registration is only marked
+ *   dead, so pending events for it can be skipped safely
+ *
+ * @param[out] w The registration
+ */
+void _process_watch_remove(struct ProcessWatch* w) {
+  struct ProcessGroup* g = w->group;
+
+  // Unregister every stream
+  for (int i = 0; i < 4; i++) {
+    _process_watch_stream_remove(&w->streams[i]);
+  }
+  if (w->sweep) {
+    w->sweep = 0;
+    g->sweeps--;
+  }
+  w->p->watch = NULL;
+
+  // Unlink from the group
+  if (w->prev != NULL) {
+    w->prev->next = w->next;
+  }
+  else {
+    g->head = w->next;
+  }
+  if (w->next != NULL) {
+    w->next->prev = w->prev;
+  }
+
+  // Free now, or once the current dispatch is over
+  if (g->polling) {
+    w->dead    = 1;
+    w->garbage = g->garbage;
+    g->garbage = w;
+  }
+  else {
+    free(w);
+  }
+}
+
+/**
+ * @brief Process Watch Stream Remove
+ *
+ * Stops watching one stream of a Process
+ *
+ * @param[out] ws The watched stream
+ */
+void _process_watch_stream_remove(struct ProcessWatchStream* ws) {
+  if (ws->fd != -1) {
+    _process_group_register(ws->watch->group, ws, 0);
+    ws->fd = -1;
+  }
+}
+
+/**
+ * @brief Process Write Full
+ *
+ * Writes exactly len bytes to a file descriptor
+ *
+ * @param fd  The file descriptor
+ * @param buf The source buffer
+ * @param len The number of bytes to write
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_write_full(int fd, const void* buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t count = write(fd, (const char*)buf + done, len - done);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return 0;
+    }
+    done += (size_t)count;
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Zygote Main
+ *
+ * Serves launch requests until the parent closes its end of the socket
+ *
+ * @remarks
+ * Only called in the zygote; never returns
+ *
+ * @param fd The zygote's end of the socket
+ */
+void _process_zygote_main(int fd) {
+  // Reap children from the loop, so each one stays a zombie (keeping its
+  //   pid) until its pidfd has been opened
+  signal(SIGPIPE, SIG_IGN);
+  if (!_process_pipe(_process_zygote_wake)) {
+    _exit(1);
+  }
+  fcntl(_process_zygote_wake[0], F_SETFL, O_NONBLOCK);
+  fcntl(_process_zygote_wake[1], F_SETFL, O_NONBLOCK);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = _process_zygote_sigchld;
+  action.sa_flags   = SA_RESTART | SA_NOCLDSTOP;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGCHLD, &action, NULL);
+
+  // Serve requests until the parent goes away
+  int alive = 1;
+  while (alive) {
+    struct pollfd pfds[2] = {
+      { fd, POLLIN, 0 },
+      { _process_zygote_wake[0], POLLIN, 0 }
+    };
+    if (poll(pfds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (pfds[1].revents != 0) {
+      char drain[64];
+      while (read(_process_zygote_wake[0], drain, sizeof(drain)) > 0);
+      _process_zygote_reap();
+    }
+    if (pfds[0].revents != 0) {
+      alive = _process_zygote_serve(fd);
+    }
+  }
+  _exit(0);
+}
+
+/**
+ * @brief Process Zygote Reap
+ *
+ * Reaps every child of the zygote that has exited, reporting each one's
+ *   wait status and resource usage to the parent through its exit pipe
+ *
+ * @remarks
+ * Only called in the zygote
+ */
+void _process_zygote_reap(void) {
+  for (;;) {
+    struct ProcessZygoteExit report;
+    memset(&report, 0, sizeof(report));
+    pid_t pid = wait4(-1, &report.status, WNOHANG, &report.usage);
+    if (pid == -1 && errno == EINTR) {
+      continue;
+    }
+    if (pid <= 0) {
+      break;
+    }
+    for (size_t i = 0; i < _process_zygote_child_count; i++) {
+      struct ProcessZygoteChild* child = &_process_zygote_children[i];
+      if (child->pid == pid) {
+        _process_write_full(child->fd, &report, sizeof(report));
+        close(child->fd);
+        *child = _process_zygote_children[--_process_zygote_child_count];
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Process Zygote Receive
+ *
+ * Receives a launch reply from the zygote, along with the fds attached
+ *
+ * @param      fd    The parent's end of the socket
+ * @param[out] reply The reply
+ * @param[out] fds   The child's exit pipe and pidfd (left alone if they
+ *                   aren't attached)
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_zygote_receive(int fd, struct ProcessZygoteReply* reply,
+    int fds[2]) {
+  union {
+    struct cmsghdr header;
+    char           space[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct iovec iov = { reply, sizeof(*reply) };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.space;
+  msg.msg_controllen = sizeof(control.space);
+
+  // Receive the reply and the fds (atomically close-on-exec where possible)
+  int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+  flags = MSG_CMSG_CLOEXEC;
+#endif
+  ssize_t count;
+  do {
+    count = recvmsg(fd, &msg, flags);
+  } while (count < 0 && errno == EINTR);
+  if (count <= 0) {
+    return 0;
+  }
+  int received[2] = { -1, -1 };
+  size_t n = 0;
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+    n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    n = (n < 2 ? n : 2);
+    memcpy(received, CMSG_DATA(cmsg), n * sizeof(int));
+  }
+  int ok = _process_read_full(fd, (char*)reply + count,
+    sizeof(*reply) - (size_t)count);
+
+  // Sort the fds out by what the reply says is attached
+  size_t next = 0;
+  for (int i = 0; i < 2; i++) {
+    if (ok && next < n && (reply->attached & (1 << i))) {
+      fds[i] = received[next++];
+#ifndef MSG_CMSG_CLOEXEC
+      fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+#endif
+    }
+  }
+  while (next < n) {
+    close(received[next++]);
+  }
+  return ok;
+}
+
+/**
+ * @brief Process Zygote Send
+ *
+ * Sends a launch reply to the parent, attaching the child's exit pipe and
+ *   pidfd
+ *
+ * @remarks
+ * Only called in the zygote
+ *
+ * @param fd    The zygote's end of the socket
+ * @param reply The reply
+ * @param fds   The exit pipe and pidfd to attach (-1 for those missing)
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+int _process_zygote_send(int fd, const struct ProcessZygoteReply* reply,
+    const int fds[2]) {
+  union {
+    struct cmsghdr header;
+    char           space[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct ProcessZygoteReply header = *reply;
+  int attach[2];
+  size_t n = 0;
+  header.attached = 0;
+  for (int i = 0; i < 2; i++) {
+    if (fds[i] != -1) {
+      header.attached |= 1 << i;
+      attach[n++] = fds[i];
+    }
+  }
+  struct iovec iov = { &header, sizeof(header) };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov    = &iov;
+  msg.msg_iovlen = 1;
+  if (n > 0) {
+    msg.msg_control    = control.space;
+    msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(n * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), attach, n * sizeof(int));
+  }
+
+  // Send the reply, then whatever a short send left out
+  ssize_t sent;
+  do {
+    sent = sendmsg(fd, &msg, 0);
+  } while (sent < 0 && errno == EINTR);
+  if (sent <= 0) {
+    return 0;
+  }
+  return _process_write_full(fd, (const char*)&header + sent,
+    sizeof(header) - (size_t)sent);
+}
+
+/**
+ * @brief Process Zygote Serve
+ *
+ * Receives one launch request, forks and execs it, and replies with its pid
+ *   (and its exit pipe and pidfd)
+ *
+ * @param fd The zygote's end of the socket
+ *
+ * @return 1 if another request can be served, 0 if the socket is closed
+ */
+int _process_zygote_serve(int fd) {
+  struct ProcessZygoteRequest request;
+  union {
+    struct cmsghdr header;
+    char           space[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  struct iovec iov = { &request, sizeof(request) };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.space;
+  msg.msg_controllen = sizeof(control.space);
+
+  // Receive the header and the stdio fds
+  ssize_t count;
+  do {
+    count = recvmsg(fd, &msg, 0);
+  } while (count < 0 && errno == EINTR);
+  if (count <= 0) {
+    return 0;
+  }
+  int fds[3] = { -1, -1, -1 };
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len == CMSG_LEN(3 * sizeof(int))) {
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+  }
+  if (!_process_read_full(fd, (char*)&request + count,
+        sizeof(request) - (size_t)count)) {
+    return 0;
+  }
+
+  // Receive the string block
+  char*  block = malloc(request.size);
+  char** argv  = calloc(request.argc + 1, sizeof(char*));
+  char** envp  = calloc(request.envc + 1, sizeof(char*));
+  struct ProcessZygoteReply reply = { -1, ENOMEM, 0 };
+  int attach[2] = { -1, -1 };
+  int alive = 1;
+  if (block == NULL || argv == NULL || envp == NULL) {
+    alive = 0;
+  }
+  else if (!_process_read_full(fd, block, request.size)) {
+    alive = 0;
+  }
+  else if (fds[0] == -1) {
+    reply.error = EBADF;
+  }
+  else {
+    // Unpack path, argv and envp
+    char* pos = block;
+    char* path = pos;
+    pos += strlen(pos) + 1;
+    for (uint32_t i = 0; i < request.argc; i++) {
+      argv[i] = pos;
+      pos += strlen(pos) + 1;
+    }
+    for (uint32_t i = 0; i < request.envc; i++) {
+      envp[i] = pos;
+      pos += strlen(pos) + 1;
+    }
+
+    // Fork and exec, collecting a failed exec's errno from the error pipe
+    //   (the child can't be reaped before it is opened as a pidfd, since only
+    //   this loop reaps)
+    int report[2] = { -1, -1 };
+    reply.pid = -1;
+    if (_process_pipe(report)) {
+      reply.pid = fork();
+    }
+    if (reply.pid == 0) {
+      close(fd);
+      signal(SIGCHLD, SIG_DFL);
+      signal(SIGPIPE, SIG_DFL);
+      if (report[1] <= STDERR_FILENO) {
+        report[1] = fcntl(report[1], F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+      }
+      dup2(fds[STDIN_FILENO],  STDIN_FILENO);
+      dup2(fds[STDOUT_FILENO], STDOUT_FILENO);
+      dup2(fds[STDERR_FILENO], STDERR_FILENO);
+      close(fds[STDIN_FILENO]);
+      close(fds[STDOUT_FILENO]);
+      close(fds[STDERR_FILENO]);
+      _process_fds_sweep(STDERR_FILENO + 1, 0);
+      setsid();
+      execve(path, argv, envp);
+      _process_child_fail(report[1]);
+    }
+    reply.error = errno;
+    if (reply.pid != -1) {
+      // A child that failed is reaped with the others
+      int child_error;
+      ssize_t count;
+      close(report[1]);
+      do {
+        count = read(report[0], &child_error, sizeof(child_error));
+      } while (count == -1 && errno == EINTR);
+      if (count == (ssize_t)sizeof(child_error)) {
+        reply.pid   = -1;
+        reply.error = child_error;
+      }
+      close(report[0]);
+    }
+    else if (report[0] != -1) {
+      close(report[0]);
+      close(report[1]);
+    }
+    if (reply.pid != -1) {
+      attach[0] = _process_zygote_track(reply.pid);
+#if defined(__linux__) && defined(SYS_pidfd_open)
+      attach[1] = (int)syscall(SYS_pidfd_open, reply.pid, 0);
+#endif
+    }
+  }
+
+  // Close the received fds and reply
+  for (int i = 0; i < 3; i++) {
+    if (fds[i] != -1) {
+      close(fds[i]);
+    }
+  }
+  free(block);
+  free(argv);
+  free(envp);
+  if (alive && !_process_zygote_send(fd, &reply, attach)) {
+    alive = 0;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (attach[i] != -1) {
+      close(attach[i]);
+    }
+  }
+  return alive;
+}
+
+/**
+ * @brief Process Zygote SIGCHLD
+ *
+ * Wakes the zygote's loop to reap its children
+ *
+ * @remarks
+ * Only installed in the zygote; async-signal-safe
+ *
+ * @param sig The signal (SIGCHLD)
+ */
+void _process_zygote_sigchld(int sig) {
+  (void)sig;
+  int saved = errno;
+  ssize_t count = write(_process_zygote_wake[1], "", 1);
+  (void)count;
+  errno = saved;
+}
+
+/**
+ * @brief Process Zygote Track
+ *
+ * Opens the exit pipe of a new child of the zygote, whose write end gets
+ *   its wait status once it is reaped
+ *
+ * @remarks
+ * Only called in the zygote
+ *
+ * @param pid The pid of the child
+ *
+ * @return The read end of the exit pipe, or -1 upon failure
+ */
+int _process_zygote_track(pid_t pid) {
+  if (_process_zygote_child_count == _process_zygote_child_cap) {
+    size_t cap = (_process_zygote_child_cap > 0 ?
+      _process_zygote_child_cap * 2 : 16);
+    struct ProcessZygoteChild* children = realloc(_process_zygote_children,
+      cap * sizeof(struct ProcessZygoteChild));
+    if (children == NULL) {
+      return -1;
+    }
+    _process_zygote_children  = children;
+    _process_zygote_child_cap = cap;
+  }
+  int fds[2];
+  if (!_process_pipe(fds)) {
+    return -1;
+  }
+  struct ProcessZygoteChild* child =
+    &_process_zygote_children[_process_zygote_child_count++];
+  child->pid = pid;
+  child->fd  = fds[1];
+  return fds[0];
+}
+
+/**
+ * @brief Process Add Argument
+ *
+ * Adds an argument to an existing Process
+ *
+ * @param[out] p   The Process object
+ * @param      arg The environment variable to append
+ */
+extern void process_add_arg(struct Process* p, const char* arg) {
+  // Push arg on to p->argv
+  _process_array_push(&p->argv, &p->argc, &p->argv_cap, &p->argv_arena,
+    arg);
+}
+
+/**
+ * @brief Process Add Arguments
+ *
+ * Adds arguments to an existing Process
+ *
+ * @param[out] p   The Process object
+ * @param      arg The environment variable to append
+ */
+extern void process_add_args(struct Process* p, char* const args[]) {
+  // Allocate room for every argument up front
+  _process_array_reserve(&p->argv, &p->argv_cap,
+    p->argc + _process_array_count(args));
+  // Add arguments
+  for (int i = 0; args != NULL && args[i] != NULL; i++) {
+    process_add_arg(p, args[i]);
+  }
+}
+
+/**
+ * @brief Process Add Environment Variable
+ *
+ * Adds an environment variable to an existing Process
+ *
+ * @remarks
+ * A variable that is already set is overridden in place rather than
+ *   duplicated
+ *
+ * @param[out] p   The Process object
+ * @param      env The environment variable to append ("NAME=value")
+ */
+extern void process_add_env(struct Process* p, const char* env) {
+  // Copy env to the arena
+  size_t len = strlen(env) + 1;
+  char* copy = _process_arena_alloc(&p->envp_arena, len);
+  if (copy != NULL) {
+    memcpy(copy, env, len);
+    // Push env on to p->envp
+    _process_env_put(&p->envp, &p->envc, &p->envp_cap, &p->env_index, copy);
+    p->env_dirty = 1;
+  }
+}
+
+/**
+ * @brief Process Add Environment Variables
+ *
+ * Adds environment variables to an existing Process
+ *
+ * @param[out] p   The Process object
+ * @param      env The environment variable to append
+ */
+extern void process_add_envs(struct Process* p, char* const envs[]) {
+  // Allocate room for every environment variable up front
+  _process_array_reserve(&p->envp, &p->envp_cap,
+    p->envc + _process_array_count(envs));
+  // Add environment variables
+  for (int i = 0; envs != NULL && envs[i] != NULL; i++) {
+    process_add_env(p, envs[i]);
+  }
+}
+
+/**
+ * @brief Process Capture
+ *
+ * Reads the output available on a captured stream into its buffer
+ *
+ * @remarks
+ *  - Reads until end of stream, or until the pipe is empty when
+ *    PROCESS_OPTION_NONBLOCK is set (call it from a readiness callback)
+ *  - Data is read straight into the capture buffer; in RING mode the whole
+ *    ring is offered to each readv, overwriting the oldest output
+ *  - With PROCESS_OPTION_PTY, the EIO a pseudo-terminal reports once the
+ *    child has closed it is end of stream
+ *
+ * @param[out] p      The Process object
+ * @param      stream The stream (PROCESS_STREAM_OUT or _ERR)
+ *
+ * @return The number of bytes captured, 0 at end of stream, or -1 upon
+ *   failure (EAGAIN if nothing was available)
+ */
+extern ssize_t process_capture(struct Process* p, int stream) {
+  return _process_capture(p, stream);
+}
+
+/**
+ * @brief Process Clear argv
+ *
+ * Clears the Process object's arguments
+ *
+ * @remarks
+ * Frees all arguments and the argv property
+ *
+ * @param[out] p The Process object
+ */
+extern void process_clear_argv(struct Process* p) {
+  // Free arguments
+  _process_array_clear(&p->argv, &p->argc, &p->argv_cap, &p->argv_arena);
+  p->argv = NULL;
+}
+
+/**
+ * @brief Process Clear envp
+ *
+ * Clears the Process object's environment variables
+ *
+ * @remarks
+ * Frees all environment variables and the envp property
+ *
+ * @param[out] p The Process object
+ */
+extern void process_clear_envp(struct Process* p) {
+  // Free environment variables
+  _process_array_clear(&p->envp, &p->envc, &p->envp_cap, &p->envp_arena);
+  _process_env_index_clear(&p->env_index);
+  p->envp = NULL;
+  p->env_dirty = 1;
+}
+
+/**
+ * @brief Process Clear FDs
+ *
+ * Stops passing extra fds through to the Process
+ *
+ * @param[out] p The Process object
+ */
+extern void process_clear_fds(struct Process* p) {
+  p->fd_count = 0;
+}
+
+/**
+ * @brief Process Close
+ *
+ * Closes the Process' pipes, kills the process, and reaps its zombie
+ *
+ * @remarks
+ *  - After closing a Process, it can be reused
+ *  - Buffers still queued with process_feed are dropped
+ *
+ * @param[out] p The Process object
+ */
+extern void process_close(struct Process* p) {
+  // Stop watching the pipes and drop the buffers queued for stdin
+  if (p->watch != NULL) {
+    _process_watch_remove(p->watch);
+  }
+  _process_feed_drop(p);
+
+  // Close pipes
+  if (p->in != -1) {
+    close(p->in);
+    p->in  = -1;
+  }
+  if (p->out != -1) {
+    close(p->out);
+    p->out = -1;
+  }
+  if (p->err != -1) {
+    close(p->err);
+    p->err = -1;
+  }
+
+  // Kill process and reap its zombie
+  if (p->pid != -1) {
+    if (!p->exited) {
+      if (p->zygote) {
+        _process_signal(p, SIGKILL);
+      }
+      else {
+        kill(p->pid, SIGKILL);
+      }
+      _process_reap(p, 1);
+    }
+    if (p->pidfd != -1) {
+      close(p->pidfd);
+      p->pidfd = -1;
+    }
+    if (p->exit_fd != -1) {
+      close(p->exit_fd);
+      p->exit_fd = -1;
+    }
+    p->pid = -1;
+  }
+}
+
+/**
+ * @brief Process Create
+ *
+ * Creates a Process object with a binary, arguments, and environment
+ *
+ * @remarks
+ *  - This function inserts the path as the first argument (standard on linux)
+ *  - It is recommended to obtain the envp argument from `int main(...)`
+ *  - argv and envp must end with a NULL pointer
+ *  - A Process freed earlier by the same thread is reused when available,
+ *    along with its storage, so creating and freeing Process objects in a
+ *    loop doesn't touch the allocator once their buffers are warm
+ *
+ * @param path The path to the binary
+ * @param argv The argument list
+ * @param envp The environment variable list
+ *
+ * @return The Process object, or NULL upon failure
+ */
+extern struct Process* process_create(const char* path, char* const argv[],
+    char* const envp[]) {
+  // Reuse a Process freed by this thread, or allocate a new one
+  struct ProcessCache* cache = _process_cache(0);
+  struct Process* p = NULL;
+  if (cache != NULL && cache->count > 0) {
+    p = cache->items[--cache->count];
+  }
+  else {
+    p = malloc(sizeof(struct Process));
+    if (p == NULL) {
+      return NULL;
+    }
+    memset(p, 0, sizeof(struct Process));
+    p->pidfd     = -1;
+    p->cgroup_fd = -1;
+    p->exit_fd   = -1;
+  }
+  _process_reset(p);
+
+  // Copy the provided path to the Process
+  if (!_process_path_set(p, path)) {
+    _process_destroy(p);
+    return NULL;
+  }
+
+  // Add arguments
+  process_add_args(p, argv);
+
+  // Add environment variables
+  process_add_envs(p, envp);
+
+  return p;
+}
+
+/**
+ * @brief Process Create (lookup)
+ *
+ * Creates a Process object for an executable found by searching a PATH
+ *
+ * @remarks
+ *  - A name containing a slash is used as-is, like execvp does
+ *  - Results are cached by name and PATH, so repeated creations skip the
+ *    filesystem walk; every hit checks the modification times of the PATH
+ *    directories searched, so executables added to or removed from them
+ *    are noticed at once
+ *  - Safe to call from many threads
+ *
+ * @param name   The executable name (such as "curl")
+ * @param argv   The argument list
+ * @param envp   The environment variable list
+ * @param search The PATH to search, or NULL for the caller's PATH
+ *
+ * @return The Process object, or NULL if the executable wasn't found
+ */
+extern struct Process* process_create_lookup(const char* name,
+    char* const argv[], char* const envp[], const char* search) {
+  if (strchr(name, '/') != NULL) {
+    return process_create(name, argv, envp);
+  }
+  if (search == NULL) {
+    search = getenv("PATH");
+  }
+  if (search == NULL) {
+    search = "/usr/local/bin:/usr/bin:/bin";
+  }
+
+  char* path = _process_lookup(name, search);
+  if (path == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+  struct Process* p = process_create(path, argv, envp);
+  free(path);
+  return p;
+}
+
+/**
+ * @brief Process Environment Template Create
+ *
+ * Creates an immutable environment that many Process objects can share
+ *
+ * @remarks
+ *  - The template starts with one reference, held by the caller
+ *  - envs must end with a NULL pointer
+ *
+ * @param envs The environment variable list
+ *
+ * @return The environment template, or NULL upon failure
+ */
+extern struct ProcessEnvTemplate* process_env_template_create(
+    char* const envs[]) {
+  // Allocate and initialize a new template
+  struct ProcessEnvTemplate* t = malloc(sizeof(struct ProcessEnvTemplate));
+  if (t == NULL) {
+    return NULL;
+  }
+  t->envp       = NULL;
+  t->envc       = 0;
+  t->arena.head = NULL;
+  t->index.slots = NULL;
+  t->index.cap   = 0;
+  t->index.count = 0;
+  t->refs        = 1;
+
+  // Copy and index environment variables
+  size_t cap = 0;
+  _process_array_reserve(&t->envp, &cap, _process_array_count(envs));
+  for (int i = 0; envs != NULL && envs[i] != NULL; i++) {
+    size_t len = strlen(envs[i]) + 1;
+    char* copy = _process_arena_alloc(&t->arena, len);
+    if (copy != NULL) {
+      memcpy(copy, envs[i], len);
+      _process_env_put(&t->envp, &t->envc, &cap, &t->index, copy);
+    }
+  }
+
+  return t;
+}
+
+/**
+ * @brief Process Environment Template Release
+ *
+ * Drops a reference to an environment template
+ *
+ * @remarks
+ * The template is destroyed once its last reference is dropped
+ *
+ * @param[out] t The environment template
+ */
+extern void process_env_template_release(struct ProcessEnvTemplate* t) {
+  _process_env_template_drop(t);
+}
+
+/**
+ * @brief Process Environment Template Retain
+ *
+ * Adds a reference to an environment template
+ *
+ * @param[out] t The environment template
+ *
+ * @return The environment template
+ */
+extern struct ProcessEnvTemplate* process_env_template_retain(
+    struct ProcessEnvTemplate* t) {
+  if (t != NULL) {
+    _PROCESS_REF_ADD(t->refs);
+  }
+  return t;
+}
+
+/**
+ * @brief Process Feed
+ *
+ * Queues a copy of some bytes to be written to a Process' stdin
+ *
+ * @remarks
+ *  - Small writes are coalesced into shared storage, so many of them are
+ *    written with one writev
+ *  - The bytes are written by process_feed_flush, or by the Process'
+ *    ProcessGroup as stdin becomes writable
+ *  - The returned number of bytes queued lets producers apply backpressure
+ *    (stop feeding above a watermark of their choice)
+ *
+ * @param[out] p   The Process object
+ * @param      buf The bytes to write
+ * @param      len The number of bytes to write
+ *
+ * @return The number of bytes queued, or -1 upon failure
+ */
+extern ssize_t process_feed(struct Process* p, const void* buf, size_t len) {
+  struct ProcessFeed* f = _process_feed_get(p);
+  if (f == NULL) {
+    return -1;
+  }
+  if (f->closing) {
+    errno = EPIPE;
+    return -1;
+  }
+
+  // Append to the newest buffer if its storage has room
+  if (f->count > 0) {
+    struct ProcessFeedEntry* e = &f->entries[(f->head + f->count - 1) &
+      (f->cap - 1)];
+    if (e->owned != NULL && e->spare >= len) {
+      memcpy((char*)e->iov.iov_base + e->iov.iov_len, buf, len);
+      e->iov.iov_len += len;
+      e->spare       -= len;
+      f->pending     += len;
+      return (ssize_t)f->pending;
+    }
+  }
+
+  // Copy into new storage
+  size_t size = (len > _PROCESS_FEED_CHUNK ? len : _PROCESS_FEED_CHUNK);
+  char* owned = malloc(size);
+  if (owned == NULL) {
+    return -1;
+  }
+  memcpy(owned, buf, len);
+  if (!_process_feed_push(p, owned, len, owned, size - len, NULL, NULL)) {
+    free(owned);
+    return -1;
+  }
+  return (ssize_t)f->pending;
+}
+
+/**
+ * @brief Process Feed Close
+ *
+ * Closes a Process' stdin once every queued buffer has been written
+ *
+ * @remarks
+ * Closes stdin at once if nothing is queued; nothing more can be fed
+ *   afterwards
+ *
+ * @param[out] p The Process object
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_feed_close(struct Process* p) {
+  struct ProcessFeed* f = _process_feed_get(p);
+  if (f == NULL) {
+    return 0;
+  }
+  f->closing = 1;
+  return (_process_feed_flush(p) != -1 ? 1 : 0);
+}
+
+/**
+ * @brief Process Feed Flush
+ *
+ * Writes as many queued buffers to a Process' stdin as the pipe accepts
+ *
+ * @remarks
+ *  - Up to _PROCESS_FEED_IOVS buffers are written per writev; with
+ *    PROCESS_OPTION_NONBLOCK it returns once the pipe is full, otherwise it
+ *    blocks until everything is written
+ *  - With PROCESS_OPTION_VMSPLICE, caller-owned buffers are handed to the
+ *    pipe with vmsplice on Linux (the pages are referenced, not copied)
+ *  - Once everything is written, stdin is closed if process_feed_close was
+ *    called
+ *  - If the child closed its stdin, the queue is dropped; ignore SIGPIPE to
+ *    get EPIPE instead of being killed by it
+ *  - Completion callbacks must not close or free the Process
+ *
+ * @param[out] p The Process object
+ *
+ * @return The number of bytes still queued, or -1 upon failure
+ */
+extern ssize_t process_feed_flush(struct Process* p) {
+  return _process_feed_flush(p);
+}
+
+/**
+ * @brief Process Feed iovec
+ *
+ * Queues caller-owned buffers to be written to a Process' stdin without
+ *   copying them
+ *
+ * @remarks
+ *  - The buffers must stay valid and unchanged until the callback is called
+ *    (with written set to 1 once they have all been written, or 0 if they
+ *    were dropped by process_close, process_free or a failed write)
+ *  - With PROCESS_OPTION_VMSPLICE the pipe references the buffers' pages
+ *    rather than a copy, so they must stay unchanged until the child has
+ *    read them too (such as until it exits), not just until the callback
+ *  - See process_feed for when they are written
+ *
+ * @param[out] p        The Process object
+ * @param      iov      The buffers
+ * @param      n        The number of buffers
+ * @param      callback Called once the buffers are done (or NULL)
+ * @param      data     User data passed to the callback
+ *
+ * @return The number of bytes queued, or -1 upon failure
+ */
+extern ssize_t process_feed_iov(struct Process* p, const struct iovec iov[],
+    size_t n, ProcessFeedCallback callback, void* data) {
+  struct ProcessFeed* f = _process_feed_get(p);
+  if (f == NULL) {
+    return -1;
+  }
+  if (f->closing) {
+    errno = EPIPE;
+    return -1;
+  }
+
+  // The callback rides on the last buffer (an empty one if there are none)
+  for (size_t i = 0; i < n || i == 0; i++) {
+    int last = (i + 1 >= n);
+    if (!_process_feed_push(p, (n > 0 ? iov[i].iov_base : NULL),
+          (n > 0 ? iov[i].iov_len : 0), NULL, 0, (last ? callback : NULL),
+          data)) {
+      return -1;
+    }
+  }
+  return (ssize_t)f->pending;
+}
+
+/**
+ * @brief Process Feed Pending
+ *
+ * Gets the number of bytes queued for a Process' stdin
+ *
+ * @param p The Process object
+ *
+ * @return The number of bytes queued
+ */
+extern size_t process_feed_pending(struct Process* p) {
+  return (p->feed != NULL ? p->feed->pending : 0);
+}
+
+/**
+ * @brief Process Forward Output
+ *
+ * Moves the data available on a Process stream to another fd
+ *
+ * @remarks
+ *  - On Linux the data is spliced from the pipe without passing through user
+ *    space; elsewhere (or when splice refuses dst_fd) a bounce buffer is used
+ *  - Reads at most one chunk per call, so it fits in a readiness callback
+ *  - Honours PROCESS_OPTION_NONBLOCK on the source stream
+ *
+ * @param p      The Process object
+ * @param stream The stream to forward (PROCESS_STREAM_OUT or _ERR)
+ * @param dst_fd The destination fd (file, socket, pipe, ...)
+ *
+ * @return The number of bytes moved, 0 at end of stream, or -1 upon failure
+ */
+extern ssize_t process_forward_output(struct Process* p, int stream,
+    int dst_fd) {
+  int src_fd = _process_stream_fd(p, stream);
+  if (src_fd == -1 || stream == PROCESS_STREAM_IN) {
+    errno = EBADF;
+    return -1;
+  }
+
+#ifdef __linux__
+  // Splice straight from the pipe
+  unsigned int flags = SPLICE_F_MOVE;
+  if (p->options & PROCESS_OPTION_NONBLOCK) {
+    flags |= SPLICE_F_NONBLOCK;
+  }
+  ssize_t moved = splice(src_fd, NULL, dst_fd, NULL, _PROCESS_FORWARD_CHUNK,
+    flags);
+  if (moved > 0) {
+    _PROCESS_STAT(bytes_read, (uint64_t)moved);
+  }
+  if (moved >= 0 || (errno != EINVAL && errno != ENOSYS)) {
+    return moved;
+  }
+#endif
+
+  // Bounce the data through a buffer
+  char buf[_PROCESS_FORWARD_BUFFER];
+  ssize_t count = read(src_fd, buf, sizeof(buf));
+  if (count < 0 && errno == EIO && (p->options & PROCESS_OPTION_PTY)) {
+    count = 0;
+  }
+  if (count > 0) {
+    _PROCESS_STAT(bytes_read, (uint64_t)count);
+    if (!_process_write_full(dst_fd, buf, (size_t)count)) {
+      return -1;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Process Free
+ *
+ * Closes and destroys the Process object
+ *
+ * @remarks
+ *  - After freeing a Process, it cannot be reused
+ *  - Up to _PROCESS_CACHE_MAX freed objects per thread are kept, emptied,
+ *    for that thread's next process_create (and destroyed when it exits)
+ *
+ * @param[out] p The process object
+ */
+extern void process_free(struct Process* p) {
+  if (p != NULL) {
+    // // Close the process
+    // process_close(p);
+
+    // Keep the Process for this thread's next process_create
+    struct ProcessCache* cache = _process_cache(1);
+    if (cache != NULL && cache->count < _PROCESS_CACHE_MAX) {
+      _process_reset(p);
+      cache->items[cache->count++] = p;
+    }
+    else {
+      _process_destroy(p);
+    }
+  }
+}
+
+/**
+ * @brief Process Get Capture
+ *
+ * Gets the output captured from one of a Process' streams
+ *
+ * @remarks
+ *  - In RING mode the ring is rotated in place so the output is contiguous
+ *  - The data stays valid until the next process_capture or launch, and is
+ *    not NUL-terminated
+ *
+ * @param[out] p      The Process object
+ * @param      stream The stream (PROCESS_STREAM_OUT or _ERR)
+ * @param[out] len    The number of bytes captured
+ *
+ * @return The captured output, or NULL if nothing was captured
+ */
+extern const char* process_get_capture(struct Process* p, int stream,
+    size_t* len) {
+  *len = 0;
+  if (stream != PROCESS_STREAM_OUT && stream != PROCESS_STREAM_ERR) {
+    return NULL;
+  }
+  struct ProcessCapture* c = &p->capture[stream];
+  if (c->len == 0) {
+    return NULL;
+  }
+  if (c->start + c->len > c->cap) {
+    _process_capture_rotate(c);
+  }
+  *len = c->len;
+  return c->data + c->start;
+}
+
+/**
+ * @brief Process Get Environment Variable
+ *
+ * Looks up the value of an environment variable of a Process object
+ *
+ * @remarks
+ * Variables set on the Process take priority over its environment template
+ *
+ * @param p    The Process object
+ * @param name The name of the variable
+ *
+ * @return The value of the variable, or NULL if it isn't set
+ */
+extern const char* process_get_env(struct Process* p, const char* name) {
+  size_t len = strlen(name);
+
+  // Check the Process' own variables
+  struct ProcessEnvSlot* slot = _process_env_index_find(&p->env_index, name,
+    len);
+  if (slot != NULL) {
+    return (slot->index != SIZE_MAX ? slot->key + len + 1 : NULL);
+  }
+
+  // Check the environment template
+  if (p->env_template != NULL) {
+    slot = _process_env_index_find(&p->env_template->index, name, len);
+    if (slot != NULL) {
+      return slot->key + len + 1;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Process Get Statistics
+ *
+ * Aggregates the statistics counters of every thread
+ *
+ * @remarks
+ *  - Counters of threads that have exited are kept; counters still being
+ *    updated are read as they are, so concurrent launches may or may not be
+ *    included
+ *  - Counts are relative to the last process_reset_stats, except unreaped
+ *  - Bytes read by the caller straight from out and err aren't counted
+ *
+ * @param[out] stats The aggregated counters
+ */
+extern void process_get_stats(struct ProcessStats* stats) {
+  struct ProcessStats base;
+  pthread_once(&_process_stats_once, _process_stats_init);
+  pthread_mutex_lock(&_process_stats_lock);
+  _process_stats_total(stats);
+  base = _process_stats_base;
+  pthread_mutex_unlock(&_process_stats_lock);
+
+  stats->unreaped    = (stats->spawns > stats->reaped ?
+    stats->spawns - stats->reaped : 0);
+  stats->spawns     -= base.spawns;
+  stats->failures   -= base.failures;
+  stats->fds_opened -= base.fds_opened;
+  stats->bytes_read -= base.bytes_read;
+  stats->reaped     -= base.reaped;
+  for (int i = 0; i < PROCESS_STATS_BUCKETS; i++) {
+    stats->latency[i] -= base.latency[i];
+  }
+}
+
+/**
+ * @brief Process Group Add
+ *
+ * Watches the streams of a Process object from a ProcessGroup
+ *
+ * @remarks
+ *  - Adding a Process that is already in the group changes its streams,
+ *    callback and data
+ *  - Watch PROCESS_WATCH_IN only while there is data to write; an idle
+ *    stdin is always writable (data queued with process_feed is written by
+ *    the group, which watches stdin only while some is queued)
+ *  - A stream that hangs up with no data left is stopped automatically
+ *  - PROCESS_WATCH_EXIT reaps the Process when it exits, through a pidfd
+ *    (Linux) or EVFILT_PROC (kqueue); without pidfd support the group polls
+ *    for its exit instead
+ *  - With PROCESS_WATCH_DRAIN, stdout and stderr are registered
+ *    edge-triggered (EPOLLET or EV_CLEAR) and made non-blocking, and the
+ *    group reads them itself: into the capture buffer if the stream is
+ *    captured, otherwise into its slab pool for the data callback set with
+ *    process_group_set_drain; callback isn't called for them
+ *  - Closing or freeing the Process removes it from its group
+ *
+ * @param[out] g        The ProcessGroup
+ * @param[out] p        The Process object (must be open)
+ * @param      streams  A mask of PROCESS_WATCH_* streams to watch
+ * @param      callback The readiness callback
+ * @param      data     User data passed to the callback
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_group_add(struct ProcessGroup* g, struct Process* p,
+    int streams, ProcessEventCallback callback, void* data) {
+  struct ProcessWatch* w = p->watch;
+  if (w != NULL && w->group != g) {
+    // A Process belongs to one group at a time
+    _process_watch_remove(w);
+    w = NULL;
+  }
+  if (w == NULL) {
+    // Allocate and initialize a new registration
+    w = calloc(1, sizeof(struct ProcessWatch));
+    if (w == NULL) {
+      return 0;
+    }
+    w->group = g;
+    w->p     = p;
+    for (int i = 0; i < 4; i++) {
+      w->streams[i].watch  = w;
+      w->streams[i].stream = i;
+      w->streams[i].fd     = -1;
+    }
+    w->next = g->head;
+    if (g->head != NULL) {
+      g->head->prev = w;
+    }
+    g->head  = w;
+    p->watch = w;
+  }
+  w->callback  = callback;
+  w->data      = data;
+  w->requested = streams;
+
+  // Re-register the output streams when switching to or from draining
+  int drain = ((streams & PROCESS_WATCH_DRAIN) ? 1 : 0);
+  if (drain != w->drain) {
+    _process_watch_stream_remove(&w->streams[PROCESS_STREAM_OUT]);
+    _process_watch_stream_remove(&w->streams[PROCESS_STREAM_ERR]);
+    w->drain = drain;
+  }
+
+  // Register the requested streams and unregister the others (stdin stays
+  //   registered while the feed has buffers queued)
+  int fds[3] = { p->in, p->out, p->err };
+  int feeding = (p->feed != NULL && p->feed->count > 0 &&
+    !(streams & PROCESS_WATCH_IN));
+  int retVal = 1;
+  for (int i = 0; i < 3; i++) {
+    struct ProcessWatchStream* ws = &w->streams[i];
+    int wanted = ((streams & (1 << i)) ||
+      (i == PROCESS_STREAM_IN && feeding)) && fds[i] != -1;
+    if (ws->fd != -1 && (!wanted || ws->fd != fds[i])) {
+      _process_watch_stream_remove(ws);
+    }
+    if (wanted && ws->fd == -1) {
+      ws->fd = fds[i];
+      if (drain && i != PROCESS_STREAM_IN) {
+        // Edge-triggered streams must be read until they would block
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+      }
+      if (!_process_group_register(g, ws, 1)) {
+        ws->fd = -1;
+        retVal = 0;
+      }
+    }
+  }
+  w->feeding = (feeding && w->streams[PROCESS_STREAM_IN].fd != -1);
+
+  // Escalate the Process' pending termination from this group
+  if (p->deadline != 0 && (g->deadline == 0 || p->deadline < g->deadline)) {
+    g->deadline = p->deadline;
+  }
+
+  // Watch for the exit of the Process
+  struct ProcessWatchStream* ws = &w->streams[_PROCESS_STREAM_EXIT];
+  int wanted = ((streams & PROCESS_WATCH_EXIT) && p->pid != -1 && !p->exited);
+  if (!wanted) {
+    _process_watch_stream_remove(ws);
+    if (w->sweep) {
+      w->sweep = 0;
+      g->sweeps--;
+    }
+  }
+  else if (ws->fd == -1 && !w->sweep) {
+#if defined(__linux__)
+    ws->fd = _process_pidfd(p);
+#else
+    ws->fd = p->pid;
+#endif
+    if (ws->fd == -1 || !_process_group_register(g, ws, 1)) {
+      ws->fd = -1;
+#if defined(__linux__)
+      // No pidfd support: poll for the exit instead
+      w->sweep = 1;
+      g->sweeps++;
+#else
+      // The Process may have exited already
+      _process_reap(p, 0);
+#endif
+    }
+  }
+  return retVal;
+}
+
+/**
+ * @brief Process Group Create
+ *
+ * Creates a ProcessGroup, which multiplexes the streams of many Process
+ *   objects with epoll (Linux) or kqueue
+ *
+ * @return The ProcessGroup, or NULL upon failure
+ */
+extern struct ProcessGroup* process_group_create(void) {
+  // Allocate and initialize a new ProcessGroup
+  struct ProcessGroup* g = malloc(sizeof(struct ProcessGroup));
+  if (g == NULL) {
+    return NULL;
+  }
+#if defined(__linux__)
+  g->fd = epoll_create1(EPOLL_CLOEXEC);
+#else
+  g->fd = kqueue();
+  if (g->fd != -1) {
+    fcntl(g->fd, F_SETFD, FD_CLOEXEC);
+  }
+#endif
+  if (g->fd == -1) {
+    free(g);
+    return NULL;
+  }
+  g->head    = NULL;
+  g->garbage = NULL;
+  g->polling = 0;
+  g->sweeps   = 0;
+  g->deadline = 0;
+  g->drain_callback = NULL;
+  g->drain_data     = NULL;
+  g->slabs          = NULL;
+  return g;
+}
+
+/**
+ * @brief Process Group Free
+ *
+ * Stops watching every Process in a ProcessGroup and destroys it
+ *
+ * @remarks
+ * The Process objects themselves are left open
+ *
+ * @param[out] g The ProcessGroup
+ */
+extern void process_group_free(struct ProcessGroup* g) {
+  if (g != NULL) {
+    while (g->head != NULL) {
+      _process_watch_remove(g->head);
+    }
+    while (g->slabs != NULL) {
+      struct ProcessSlab* next = g->slabs->next;
+      free(g->slabs);
+      g->slabs = next;
+    }
+    close(g->fd);
+    free(g);
+  }
+}
+
+/**
+ * @brief Process Group Poll
+ *
+ * Waits for readiness on the watched streams and dispatches the callbacks
+ *
+ * @remarks
+ *  - Callbacks may read, write, close or free any Process, and may add or
+ *    remove Process objects from the group
+ *  - Process objects watched with PROCESS_WATCH_EXIT are reaped as their
+ *    exit events arrive, invoking their exit callbacks
+ *  - Terminations started with process_terminate are escalated to SIGKILL
+ *    once their deadline passes
+ *  - Buffers queued with process_feed are written as stdin becomes writable
+ *
+ * @param[out] g       The ProcessGroup
+ * @param      timeout The maximum time to wait in milliseconds (-1 to block)
+ *
+ * @return The number of events dispatched, or -1 upon failure
+ */
+extern int process_group_poll(struct ProcessGroup* g, int timeout) {
+  // Wake up regularly while exits have to be polled for
+  if (g->sweeps > 0 && (timeout < 0 || timeout > _PROCESS_GROUP_SWEEP)) {
+    timeout = _PROCESS_GROUP_SWEEP;
+  }
+
+  // Wake up in time for the next termination deadline
+  if (g->deadline != 0) {
+    int64_t left = g->deadline - _process_now();
+    if (left < 0) {
+      left = 0;
+    }
+    if (timeout < 0 || left < timeout) {
+      timeout = (int)left;
+    }
+  }
+
+  int count;
+#if defined(__linux__)
+  struct epoll_event evs[_PROCESS_GROUP_EVENTS];
+  count = epoll_wait(g->fd, evs, _PROCESS_GROUP_EVENTS, timeout);
+#else
+  struct kevent evs[_PROCESS_GROUP_EVENTS];
+  struct timespec ts = { timeout / 1000, (timeout % 1000) * 1000000L };
+  count = kevent(g->fd, NULL, 0, evs, _PROCESS_GROUP_EVENTS,
+    (timeout >= 0 ? &ts : NULL));
+#endif
+  if (count < 0) {
+    return (errno == EINTR ? 0 : -1);
+  }
+
+  // Dispatch the events
+  g->polling = 1;
+  for (int i = 0; i < count; i++) {
+    int events = 0;
+#if defined(__linux__)
+    struct ProcessWatchStream* ws = evs[i].data.ptr;
+    if (evs[i].events & EPOLLIN) {
+      events |= PROCESS_EVENT_READ;
+    }
+    if (evs[i].events & EPOLLOUT) {
+      events |= PROCESS_EVENT_WRITE;
+    }
+    if (evs[i].events & (EPOLLHUP | EPOLLERR)) {
+      events |= PROCESS_EVENT_HANGUP;
+    }
+#else
+    struct ProcessWatchStream* ws = evs[i].udata;
+    if (evs[i].filter == EVFILT_READ && evs[i].data > 0) {
+      events |= PROCESS_EVENT_READ;
+    }
+    if (evs[i].filter == EVFILT_WRITE && !(evs[i].flags & EV_EOF)) {
+      events |= PROCESS_EVENT_WRITE;
+    }
+    if (evs[i].flags & (EV_EOF | EV_ERROR)) {
+      events |= PROCESS_EVENT_HANGUP;
+    }
+#endif
+    // Skip events for streams removed by an earlier callback
+    struct ProcessWatch* w = ws->watch;
+    if (w->dead || ws->fd == -1) {
+      continue;
+    }
+
+    // Reap an exited Process
+    if (ws->stream == _PROCESS_STREAM_EXIT) {
+      _process_reap(w->p, 0);
+      continue;
+    }
+
+    // Drain the feed of a writable stdin
+    int fd = ws->fd;
+    if (ws->stream == PROCESS_STREAM_IN && w->p->feed != NULL &&
+        w->p->feed->count > 0) {
+      int feeding = w->feeding;
+      _process_feed_flush(w->p);
+      if (feeding || w->dead || ws->fd != fd) {
+        continue;
+      }
+    }
+
+    // Read a drained stream for the data callback
+    if (w->drain && ws->stream != PROCESS_STREAM_IN) {
+      if (_process_group_drain(g, ws, events) && !w->dead && ws->fd == fd) {
+        _process_watch_stream_remove(ws);
+      }
+      continue;
+    }
+
+    if (w->callback != NULL) {
+      w->callback(w->p, ws->stream, events, w->data);
+    }
+
+    // Stop watching a stream that hung up with nothing left to read
+    if (!w->dead && ws->fd == fd && (events & PROCESS_EVENT_HANGUP) &&
+        !(events & PROCESS_EVENT_READ)) {
+      _process_watch_stream_remove(ws);
+    }
+  }
+
+  // Poll for the exits that can't be watched
+  for (struct ProcessWatch* w = g->head; g->sweeps > 0 && w != NULL;
+      w = w->next) {
+    if (w->sweep && !w->dead && _process_reap(w->p, 0)) {
+      count++;
+    }
+  }
+
+  // Escalate the terminations whose deadline has passed
+  _process_group_deadlines(g, _process_now());
+  g->polling = 0;
+
+  // Release the watches removed during the dispatch
+  while (g->garbage != NULL) {
+    struct ProcessWatch* next = g->garbage->garbage;
+    free(g->garbage);
+    g->garbage = next;
+  }
+  return count;
+}
+
+/**
+ * @brief Process Group Remove
+ *
+ * Stops watching the streams of a Process object
+ *
+ * @param[out] g The ProcessGroup
+ * @param[out] p The Process object
+ */
+extern void process_group_remove(struct ProcessGroup* g, struct Process* p) {
+  if (p->watch != NULL && p->watch->group == g) {
+    _process_watch_remove(p->watch);
+  }
+}
+
+/**
+ * @brief Process Group Set Drain
+ *
+ * Sets the callback receiving the data of streams drained by a ProcessGroup
+ *
+ * @remarks
+ *  - Called from process_group_poll for every readv of a stream watched with
+ *    PROCESS_WATCH_DRAIN (and not captured), with up to 8 buffers of 16 KiB
+ *    from the group's slab pool, which return to the pool once it returns
+ *  - Called with no buffers (n is 0) when a drained stream ends
+ *  - Like the readiness callbacks, it may close, free or remove any Process
+ *
+ * @param[out] g        The ProcessGroup
+ * @param      callback The data callback (or NULL to discard the data)
+ * @param      data     User data passed to the callback
+ */
+extern void process_group_set_drain(struct ProcessGroup* g,
+    ProcessDataCallback callback, void* data) {
+  g->drain_callback = callback;
+  g->drain_data     = data;
+}
+
+/**
+ * @brief Process Lookup Clear
+ *
+ * Empties the cache used by process_create_lookup
+ */
+extern void process_lookup_clear(void) {
+  pthread_mutex_lock(&_process_lookup_lock);
+  for (size_t i = 0; i < _PROCESS_LOOKUP_BUCKETS; i++) {
+    while (_process_lookup_cache[i] != NULL) {
+      struct ProcessLookupEntry* e = _process_lookup_cache[i];
+      _process_lookup_cache[i] = e->next;
+      free(e->name);
+      free(e->search);
+      free(e->path);
+      free(e);
+    }
+  }
+  pthread_mutex_unlock(&_process_lookup_lock);
+}
+
+/**
+ * @brief Process Open
+ *
+ * Launches the given Process object with its launch engine
+ *
+ * @remarks
+ *  - The trace hook (see process_set_trace_hook) is called around
+ *    creating the pipes, merging the environment and spawning the child
+ *  - Fails if the binary can't be executed (with every engine); the reason
+ *    is recorded in p->error (and errno)
+ *
+ * @param[out] p The Process object
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_open(struct Process* p) {
+  int retVal = 0;
+  if (p->pid == -1) {
+    // Prepare pipes and launch the Process
+    int child[3], parent[3];
+    _process_trace(p, PROCESS_PHASE_PIPES, 0);
+    int piped = _process_pipes_open(p, child, parent);
+    _process_trace(p, PROCESS_PHASE_PIPES, 1);
+    if (piped) {
+      retVal = _process_launch(p, child, parent);
+    }
+    else {
+      p->error = errno;
+      _PROCESS_STAT(failures, 1);
+    }
+  }
+
+  return retVal;
+}
+
+/**
+ * @brief Process Open Batch
+ *
+ * Launches many Process objects at once
+ *
+ * @remarks
+ *  - All pipes are created in one pass before any child is spawned; they are
+ *    close-on-exec so no child inherits another child's pipes
+ *  - Each Process is launched with its own engine, so selecting a fast engine
+ *    (or the default) applies to the whole batch
+ *  - Process objects that are already open are left untouched
+ *  - The status of each Process is reported through its pid (-1 on failure)
+ *    and error (the reason it couldn't be launched)
+ *
+ * @param[out] ps The Process objects
+ * @param      n  The number of Process objects
+ *
+ * @return The number of Process objects that were launched
+ */
+extern size_t process_open_batch(struct Process** ps, size_t n) {
+  size_t launched = 0;
+
+  // Allocate storage for every pipe end in the batch
+  struct ProcessBatchSlot* slots = calloc(n, sizeof(struct ProcessBatchSlot));
+  if (slots == NULL) {
+    return 0;
+  }
+
+  // Prepare pipes
+  for (size_t i = 0; i < n; i++) {
+    struct ProcessBatchSlot* slot = &slots[i];
+    if (ps[i]->pid == -1) {
+      _process_trace(ps[i], PROCESS_PHASE_PIPES, 0);
+      slot->ready = _process_pipes_open(ps[i], slot->child, slot->parent);
+      _process_trace(ps[i], PROCESS_PHASE_PIPES, 1);
+      if (!slot->ready) {
+        ps[i]->error = errno;
+        _PROCESS_STAT(failures, 1);
+      }
+    }
+  }
+
+  // Launch the Process objects
+  for (size_t i = 0; i < n; i++) {
+    if (slots[i].ready) {
+      launched += _process_launch(ps[i], slots[i].child, slots[i].parent);
+    }
+  }
+
+  free(slots);
+  return launched;
+}
+
+/**
+ * @brief Process Open Pipeline
+ *
+ * Launches Process objects as a pipeline, each one's stdout connected to the
+ *   next one's stdin
+ *
+ * @remarks
+ *  - The stages are connected with kernel pipes, so no data passes through
+ *    the caller; the first stage's stdin and the last stage's stdout (and
+ *    every stage's stderr) are wired as usual
+ *  - Every stage joins a new process group led by the first stage, so
+ *    signalling the first stage (process_terminate) reaches the whole
+ *    pipeline
+ *  - If a stage fails to launch, the stages already launched are closed;
+ *    the reason is recorded in the failed stage's error
+ *  - A stage's stdout pipe size (process_set_pipe_size) applies to the pipe
+ *    to the next stage
+ *  - The stages' stdio wiring and pgid are left as they were
+ *
+ * @param[out] ps The Process objects (none of them open)
+ * @param      n  The number of Process objects
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_open_pipeline(struct Process** ps, size_t n) {
+  int link[2] = { -1, -1 };
+  size_t i = 0;
+  for (; i < n; i++) {
+    struct Process* p = ps[i];
+    int stdio[2]    = { p->stdio[STDIN_FILENO], p->stdio[STDOUT_FILENO] };
+    int stdio_fd[2] = { p->stdio_fd[STDIN_FILENO],
+      p->stdio_fd[STDOUT_FILENO] };
+    pid_t pgid = p->pgid;
+
+    // Read from the previous stage and write to the next one
+    int in = link[0];
+    link[0] = link[1] = -1;
+    if (i + 1 < n && !_process_pipe(link)) {
+      p->error = errno;
+      if (in != -1) {
+        close(in);
+      }
+      break;
+    }
+#ifdef F_SETPIPE_SZ
+    if (link[0] != -1 && p->pipe_size[STDOUT_FILENO] > 0) {
+      fcntl(link[0], F_SETPIPE_SZ, p->pipe_size[STDOUT_FILENO]);
+    }
+#endif
+    if (in != -1) {
+      p->stdio[STDIN_FILENO]    = PROCESS_STDIO_FD;
+      p->stdio_fd[STDIN_FILENO] = in;
+    }
+    if (link[1] != -1) {
+      p->stdio[STDOUT_FILENO]    = PROCESS_STDIO_FD;
+      p->stdio_fd[STDOUT_FILENO] = link[1];
+    }
+    p->pgid = (i == 0 ? 0 : ps[0]->pid);
+    int opened = process_open(p);
+    p->stdio[STDIN_FILENO]     = stdio[0];
+    p->stdio[STDOUT_FILENO]    = stdio[1];
+    p->stdio_fd[STDIN_FILENO]  = stdio_fd[0];
+    p->stdio_fd[STDOUT_FILENO] = stdio_fd[1];
+    p->pgid = pgid;
+
+    // The children hold their ends now
+    if (in != -1) {
+      close(in);
+    }
+    if (link[1] != -1) {
+      close(link[1]);
+    }
+    if (!opened) {
+      if (link[0] != -1) {
+        close(link[0]);
+      }
+      break;
+    }
+  }
+
+  if (i < n) {
+    // Tear down the stages that were launched
+    while (i > 0) {
+      process_close(ps[--i]);
+    }
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Pass FD
+ *
+ * Passes one of the parent's fds through to the Process at launch
+ *
+ * @remarks
+ *  - Children only inherit their stdio fds and the fds passed here, unless
+ *    PROCESS_OPTION_INHERIT_FDS is set
+ *  - fd is duplicated onto child_fd in the child and stays open in the
+ *    parent; passing another fd to the same child_fd replaces it
+ *  - The posix_spawn and zygote engines fall back to vfork when fds are
+ *    passed
+ *
+ * @param[out] p        The Process object
+ * @param      fd       The parent's fd
+ * @param      child_fd The fd number in the child (above 2)
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_pass_fd(struct Process* p, int fd, int child_fd) {
+  if (fd < 0 || child_fd <= STDERR_FILENO) {
+    return 0;
+  }
+  for (size_t i = 0; i < p->fd_count; i++) {
+    if (p->fds[i].child_fd == child_fd) {
+      p->fds[i].fd = fd;
+      return 1;
+    }
+  }
+  if (p->fd_count == p->fd_cap) {
+    size_t cap = (p->fd_cap > 0 ? p->fd_cap * 2 : 4);
+    struct ProcessFdMap* fds = realloc(p->fds, cap * sizeof(*fds));
+    if (fds == NULL) {
+      return 0;
+    }
+    p->fds    = fds;
+    p->fd_cap = cap;
+  }
+  p->fds[p->fd_count].fd       = fd;
+  p->fds[p->fd_count].child_fd = child_fd;
+  p->fd_count++;
+  return 1;
+}
+
+/**
+ * @brief Process Place Batch
+ *
+ * Spreads many Process objects round-robin across CPUs or NUMA nodes
+ *
+ * @remarks
+ *  - PROCESS_PLACE_CPU pins each Process to one of the CPUs the caller may
+ *    run on
+ *  - PROCESS_PLACE_NODE pins each Process to the CPUs of one NUMA node and
+ *    binds its memory to that node
+ *  - Takes effect at the next launch, so call it before process_open_batch
+ *
+ * @param[out] ps   The Process objects
+ * @param      n    The number of Process objects
+ * @param      unit The unit to spread over (one of PROCESS_PLACE_*)
+ *
+ * @return The number of Process objects placed
+ */
+extern size_t process_place_batch(struct Process** ps, size_t n, int unit) {
+#ifdef __linux__
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return 0;
+  }
+
+  // List the units to spread over: allowed CPUs, or nodes with allowed CPUs
+  int units[_PROCESS_PLACE_CPUS];
+  int cpus[_PROCESS_PLACE_CPUS];
+  size_t count = 0;
+  if (unit == PROCESS_PLACE_CPU) {
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < _PROCESS_PLACE_CPUS; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        units[count++] = cpu;
+      }
+    }
+  }
+  else {
+    for (int node = 0; node < _PROCESS_PLACE_NODES; node++) {
+      int ncpus = _process_node_cpus(node, cpus, _PROCESS_PLACE_CPUS);
+      if (ncpus == -1) {
+        break;
+      }
+      for (int j = 0; j < ncpus; j++) {
+        if (cpus[j] < CPU_SETSIZE && CPU_ISSET(cpus[j], &allowed)) {
+          units[count++] = node;
+          break;
+        }
+      }
+    }
+  }
+
+  // Assign the units round-robin
+  size_t placed = 0;
+  for (size_t i = 0; i < n && count > 0; i++) {
+    struct ProcessPlacement* pl = _process_placement_get(ps[i]);
+    if (pl == NULL) {
+      continue;
+    }
+    int u = units[i % count];
+    memset(pl->cpus, 0, sizeof(pl->cpus));
+    if (unit == PROCESS_PLACE_CPU) {
+      pl->cpus[u / 8] |= (unsigned char)(1 << (u % 8));
+    }
+    else {
+      int ncpus = _process_node_cpus(u, cpus, _PROCESS_PLACE_CPUS);
+      for (int j = 0; j < ncpus; j++) {
+        if (cpus[j] < CPU_SETSIZE && CPU_ISSET(cpus[j], &allowed)) {
+          pl->cpus[cpus[j] / 8] |= (unsigned char)(1 << (cpus[j] % 8));
+        }
+      }
+      memset(pl->nodes, 0, sizeof(pl->nodes));
+      pl->nodes[u / (8 * sizeof(unsigned long))] |=
+        1UL << (u % (8 * sizeof(unsigned long)));
+      pl->numa_mode = PROCESS_NUMA_BIND;
+    }
+    pl->has_cpus = 1;
+    placed++;
+  }
+  return placed;
+#else
+  (void)ps;
+  (void)n;
+  (void)unit;
+  return 0;
+#endif
+}
+
+/**
+ * @brief Process Pool Spawn
+ *
+ * Launches new workers from the pool's prototype and adds them to its idle
+ *   workers
+ *
+ * @remarks
+ *  - Never exceeds the pool's maximum size; called with the pool locked
+ *  - Defined here rather than with the other internal functions because it
+ *    builds on process_create and process_open_batch
+ *
+ * @param[out] pool The ProcessPool
+ * @param      n    The number of workers to launch
+ *
+ * @return The number of workers launched
+ */
+size_t _process_pool_spawn(struct ProcessPool* pool, size_t n) {
+  struct Process* proto = pool->proto;
+  size_t total = pool->idle_count + pool->leased;
+  if (total + n > pool->max) {
+    n = pool->max - total;
+  }
+  if (n == 0) {
+    return 0;
+  }
+
+  // Copy the prototype into the free idle slots
+  struct Process** ps = &pool->idle[pool->idle_count];
+  size_t count = 0;
+  for (; count < n; count++) {
+    struct Process* w = process_create(proto->path, proto->argv, proto->envp);
+    if (w == NULL) {
+      break;
+    }
+    w->engine       = proto->engine;
+    w->options      = proto->options;
+    w->pgid         = proto->pgid;
+    for (int i = 0; i < 3; i++) {
+      w->stdio[i]        = proto->stdio[i];
+      w->stdio_fd[i]     = proto->stdio_fd[i];
+      w->pipe_size[i]    = proto->pipe_size[i];
+      w->capture[i].mode = proto->capture[i].mode;
+    }
+    for (size_t i = 0; i < proto->fd_count; i++) {
+      process_pass_fd(w, proto->fds[i].fd, proto->fds[i].child_fd);
+    }
+    if (proto->rlimit_count > 0 && w->rlimit_cap < proto->rlimit_count) {
+      struct ProcessRlimit* rlimits = realloc(w->rlimits,
+        proto->rlimit_count * sizeof(struct ProcessRlimit));
+      if (rlimits != NULL) {
+        w->rlimits    = rlimits;
+        w->rlimit_cap = proto->rlimit_count;
+      }
+    }
+    if (proto->rlimit_count > 0 && w->rlimit_cap >= proto->rlimit_count) {
+      memcpy(w->rlimits, proto->rlimits,
+        proto->rlimit_count * sizeof(struct ProcessRlimit));
+      w->rlimit_count = proto->rlimit_count;
+    }
+    if (proto->cgroup_fd != -1) {
+      w->cgroup_fd = fcntl(proto->cgroup_fd, F_DUPFD_CLOEXEC, 0);
+    }
+    if (proto->placement != NULL &&
+        _process_placement_get(w) != NULL) {
+      *w->placement = *proto->placement;
+    }
+    w->env_template = process_env_template_retain(proto->env_template);
+    w->env_dirty    = 1;
+    for (size_t i = 0; i < proto->env_index.cap; i++) {
+      // Copy the template variables unset on the prototype
+      struct ProcessEnvSlot* slot = &proto->env_index.slots[i];
+      if (slot->key != NULL && slot->index == SIZE_MAX) {
+        char* key = _process_arena_alloc(&w->envp_arena, slot->len);
+        if (key != NULL) {
+          memcpy(key, slot->key, slot->len);
+          _process_env_index_insert(&w->env_index, key, slot->len, SIZE_MAX);
+        }
+      }
+    }
+    ps[count] = w;
+  }
+
+  // Launch the workers, keeping the ones that started
+  process_open_batch(ps, count);
+  int64_t now = _process_now();
+  size_t launched = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (ps[i]->pid != -1) {
+      pool->idle_since[pool->idle_count] = now;
+      pool->idle[pool->idle_count++] = ps[i];
+      launched++;
+    }
+    else {
+      process_free(ps[i]);
+    }
+  }
+  return launched;
+}
+
+/**
+ * @brief Process Pool Acquire
+ *
+ * Leases a warm worker from a ProcessPool
+ *
+ * @remarks
+ *  - The most recently released worker is leased first, with its pipes
+ *    attached; workers that exited while idle are replaced
+ *  - A new worker is launched if none is idle and the pool isn't full; it
+ *    is leased without checking whether it already exited, so a prototype
+ *    that exits at once launches one worker per call rather than forking
+ *    again and again under the pool's lock (process_pool_release discards
+ *    it)
+ *
+ * @param[out] pool The ProcessPool
+ *
+ * @return The worker, or NULL if the pool is exhausted
+ */
+extern struct Process* process_pool_acquire(struct ProcessPool* pool) {
+  pthread_mutex_lock(&pool->lock);
+  struct Process* p = NULL;
+  while (pool->idle_count > 0) {
+    p = pool->idle[--pool->idle_count];
+    if (!_process_reap(p, 0)) {
+      pool->leased++;
+      break;
+    }
+    // Discard a worker that exited while idle
+    process_close(p);
+    process_free(p);
+    p = NULL;
+  }
+
+  // Otherwise launch one
+  if (p == NULL && _process_pool_spawn(pool, 1) > 0) {
+    p = pool->idle[--pool->idle_count];
+    pool->leased++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return p;
+}
+
+/**
+ * @brief Process Pool Create
+ *
+ * Creates a ProcessPool and launches its minimum number of workers
+ *
+ * @remarks
+ *  - Every worker is a copy of pool->proto, which is created from path,
+ *    argv and envp; configure the prototype (engine, options, environment
+ *    template) before workers are launched with process_pool_acquire
+ *  - Surplus idle workers are never evicted until an idle timeout is set
+ *
+ * @param path The path to the binary
+ * @param argv The argument list
+ * @param envp The environment variable list
+ * @param min  The number of workers kept alive
+ * @param max  The maximum number of workers (at least min and 1)
+ *
+ * @return The ProcessPool, or NULL upon failure
+ */
+extern struct ProcessPool* process_pool_create(const char* path,
+    char* const argv[], char* const envp[], size_t min, size_t max) {
+  if (max < min) {
+    max = min;
+  }
+  if (max == 0) {
+    max = 1;
+  }
+
+  // Allocate and initialize a new ProcessPool
+  struct ProcessPool* pool = malloc(sizeof(struct ProcessPool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->proto        = process_create(path, argv, envp);
+  pool->idle         = calloc(max, sizeof(struct Process*));
+  pool->idle_since   = calloc(max, sizeof(int64_t));
+  pool->idle_count   = 0;
+  pool->leased       = 0;
+  pool->min          = min;
+  pool->max          = max;
+  pool->idle_timeout = -1;
+  if (pool->proto == NULL || pool->idle == NULL || pool->idle_since == NULL ||
+      pthread_mutex_init(&pool->lock, NULL) != 0) {
+    process_free(pool->proto);
+    free(pool->idle);
+    free(pool->idle_since);
+    free(pool);
+    return NULL;
+  }
+
+  // Launch the minimum number of workers
+  _process_pool_spawn(pool, min);
+  return pool;
+}
+
+/**
+ * @brief Process Pool Evict
+ *
+ * Evicts surplus idle workers and replaces workers that exited
+ *
+ * @remarks
+ * Call periodically; workers idle for longer than the idle timeout are
+ *   closed as long as the pool keeps its minimum number of workers
+ *
+ * @param[out] pool The ProcessPool
+ *
+ * @return The number of workers evicted or discarded
+ */
+extern size_t process_pool_evict(struct ProcessPool* pool) {
+  pthread_mutex_lock(&pool->lock);
+  int64_t now = _process_now();
+  size_t evicted = 0;
+
+  // Keep the idle workers that are alive and not surplus (oldest first)
+  size_t kept = 0;
+  for (size_t i = 0; i < pool->idle_count; i++) {
+    struct Process* p = pool->idle[i];
+    size_t total = pool->idle_count - evicted + pool->leased;
+    int expired = (pool->idle_timeout >= 0 && total > pool->min &&
+      now - pool->idle_since[i] >= pool->idle_timeout);
+    if (expired || _process_reap(p, 0)) {
+      process_close(p);
+      process_free(p);
+      evicted++;
+    }
+    else {
+      pool->idle_since[kept] = pool->idle_since[i];
+      pool->idle[kept++]     = p;
+    }
+  }
+  pool->idle_count = kept;
+
+  // Top the pool back up to its minimum
+  size_t total = pool->idle_count + pool->leased;
+  if (total < pool->min) {
+    _process_pool_spawn(pool, pool->min - total);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return evicted;
+}
+
+/**
+ * @brief Process Pool Free
+ *
+ * Closes the idle workers of a ProcessPool and destroys it
+ *
+ * @remarks
+ * Workers that are still leased become owned by the caller
+ *
+ * @param[out] pool The ProcessPool
+ */
+extern void process_pool_free(struct ProcessPool* pool) {
+  if (pool != NULL) {
+    for (size_t i = 0; i < pool->idle_count; i++) {
+      process_close(pool->idle[i]);
+      process_free(pool->idle[i]);
+    }
+    process_free(pool->proto);
+    free(pool->idle);
+    free(pool->idle_since);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+  }
+}
+
+/**
+ * @brief Process Pool Release
+ *
+ * Returns a leased worker to its ProcessPool
+ *
+ * @remarks
+ * A worker that has exited (or was closed) is discarded and replaced as
+ *   needed to keep the pool at its minimum size
+ *
+ * @param[out] pool The ProcessPool
+ * @param[out] p    The worker
+ */
+extern void process_pool_release(struct ProcessPool* pool,
+    struct Process* p) {
+  pthread_mutex_lock(&pool->lock);
+  pool->leased--;
+  if (p->pid == -1 || _process_reap(p, 0)) {
+    // Discard and replace an exited worker
+    process_close(p);
+    process_free(p);
+    size_t total = pool->idle_count + pool->leased;
+    if (total < pool->min) {
+      _process_pool_spawn(pool, pool->min - total);
+    }
+  }
+  else {
+    pool->idle_since[pool->idle_count] = _process_now();
+    pool->idle[pool->idle_count++]     = p;
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Process Pool Set Idle Timeout
+ *
+ * Sets how long surplus workers may stay idle before process_pool_evict
+ *   closes them
+ *
+ * @param[out] pool    The ProcessPool
+ * @param      timeout The idle timeout in milliseconds (-1 to never evict)
+ */
+extern void process_pool_set_idle_timeout(struct ProcessPool* pool,
+    int timeout) {
+  pthread_mutex_lock(&pool->lock);
+  pool->idle_timeout = timeout;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Process Reserve Arguments
+ *
+ * Allocates room for n arguments in a Process object
+ *
+ * @remarks
+ * Callers that know the final size of argv can reserve it once up front
+ *
+ * @param[out] p The Process object
+ * @param      n The total number of arguments to make room for
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_reserve_args(struct Process* p, size_t n) {
+  return _process_array_reserve(&p->argv, &p->argv_cap, n);
+}
+
+/**
+ * @brief Process Reserve Environment Variables
+ *
+ * Allocates room for n environment variables in a Process object
+ *
+ * @remarks
+ * Callers that know the final size of envp can reserve it once up front
+ *
+ * @param[out] p The Process object
+ * @param      n The total number of environment variables to make room for
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_reserve_envs(struct Process* p, size_t n) {
+  return _process_array_reserve(&p->envp, &p->envp_cap, n);
+}
+
+/**
+ * @brief Process Rebind
+ *
+ * Points a Process object at another command, rewriting its arguments (and
+ *   optionally its environment) in place
+ *
+ * @remarks
+ *  - A Process still open is closed first (see process_close)
+ *  - The strings are copied into the storage the previous ones used, so
+ *    rebinding to a command no larger than the previous one doesn't touch
+ *    the allocator (storage that grew in several blocks is merged into one
+ *    on the first rebind)
+ *  - Everything else (engine, options, stdio wiring, pipe sizes, capture
+ *    modes, extra fds, resource limits, placement, environment template and
+ *    callbacks) is kept
+ *  - A NULL envp keeps the environment variables; otherwise they (and the
+ *    template variables unset with process_unset_env) are replaced
+ *
+ * @param[out] p    The Process object
+ * @param      path The path to the binary
+ * @param      argv The argument list (ending with a NULL pointer)
+ * @param      envp The environment variable list (ending with a NULL
+ *   pointer), or NULL
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_rebind(struct Process* p, const char* path,
+    char* const argv[], char* const envp[]) {
+  process_close(p);
+  if (!_process_path_set(p, path)) {
+    return 0;
+  }
+  p->error = 0;
+
+  // Rewrite the arguments
+  _process_array_reset(p->argv, &p->argc, &p->argv_arena);
+  process_add_args(p, argv);
+
+  // Rewrite the environment variables
+  if (envp != NULL) {
+    _process_array_reset(p->envp, &p->envc, &p->envp_arena);
+    _process_env_index_reset(&p->env_index);
+    p->env_dirty = 1;
+    process_add_envs(p, envp);
+  }
+  return 1;
+}
+
+/**
+ * @brief Process Reset Statistics
+ *
+ * Restarts the statistics counters from zero
+ *
+ * @remarks
+ * The threads' counters aren't touched (only their owners write to them);
+ *   the current totals are recorded and subtracted by process_get_stats
+ */
+extern void process_reset_stats(void) {
+  pthread_once(&_process_stats_once, _process_stats_init);
+  pthread_mutex_lock(&_process_stats_lock);
+  _process_stats_total(&_process_stats_base);
+  pthread_mutex_unlock(&_process_stats_lock);
+}
+
+/**
+ * @brief Process Set Affinity
+ *
+ * Selects the CPUs the Process may run on
+ *
+ * @remarks
+ *  - Applied in the child right before execve (Linux only)
+ *  - Takes effect at the next launch
+ *
+ * @param[out] p    The Process object
+ * @param      cpus The CPU numbers
+ * @param      n    The number of CPUs (0 to inherit the parent's affinity)
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_set_affinity(struct Process* p, const int cpus[],
+    size_t n) {
+#ifdef __linux__
+  struct ProcessPlacement* pl = _process_placement_get(p);
+  if (pl == NULL) {
+    return 0;
+  }
+  memset(pl->cpus, 0, sizeof(pl->cpus));
+  pl->has_cpus = (n > 0);
+  for (size_t i = 0; i < n; i++) {
+    if (cpus[i] < 0 || cpus[i] >= _PROCESS_PLACE_CPUS) {
+      pl->has_cpus = 0;
+      return 0;
+    }
+    pl->cpus[cpus[i] / 8] |= (unsigned char)(1 << (cpus[i] % 8));
+  }
+  return 1;
+#else
+  (void)p;
+  (void)cpus;
+  (void)n;
+  errno = ENOSYS;
+  return 0;
+#endif
+}
+
+/**
+ * @brief Process Set Capture
+ *
+ * Selects how the output of one of a Process' streams is captured
+ *
+ * @remarks
+ *  - PROCESS_CAPTURE_FULL keeps all of the output (limit is the initial
+ *    capacity, 0 for the default)
+ *  - PROCESS_CAPTURE_RING keeps only the last limit bytes, so memory stays
+ *    bounded however much the child writes
+ *  - PROCESS_CAPTURE_DISCARD connects the stream to /dev/null in the child,
+ *    so no pipe is created and nothing has to be read
+ *  - Takes effect at the next launch; captured output is dropped
+ *
+ * @param[out] p      The Process object
+ * @param      stream The stream (PROCESS_STREAM_OUT or _ERR)
+ * @param      mode   The capture mode (one of PROCESS_CAPTURE_*)
+ * @param      limit  The ring size or initial capacity in bytes
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_set_capture(struct Process* p, int stream, int mode,
+    size_t limit) {
+  if ((stream != PROCESS_STREAM_OUT && stream != PROCESS_STREAM_ERR) ||
+      mode < PROCESS_CAPTURE_NONE || mode > PROCESS_CAPTURE_DISCARD ||
+      (mode == PROCESS_CAPTURE_RING && limit == 0)) {
+    return 0;
+  }
+  struct ProcessCapture* c = &p->capture[stream];
+  if (mode == PROCESS_CAPTURE_FULL ||
+      (mode == PROCESS_CAPTURE_RING && c->cap == limit)) {
+    // Keep the buffer for the new captures
+    c->mode  = mode;
+    c->start = 0;
+    c->len   = 0;
+    c->limit = limit;
+    return 1;
+  }
+  free(c->data);
+  c->mode  = mode;
+  c->data  = NULL;
+  c->start = 0;
+  c->len   = 0;
+  c->cap   = 0;
+  c->limit = limit;
+  return 1;
+}
+
+/**
+ * @brief Process Set Cgroup
+ *
+ * Selects the cgroup v2 the Process starts in
+ *
+ * @remarks
+ *  - Where clone3 supports CLONE_INTO_CGROUP (Linux 5.7+) the child is
+ *    created inside the cgroup; otherwise it joins the cgroup before it
+ *    execs, and exits if it can't
+ *  - The cgroup directory is opened once, here
+ *
+ * @param[out] p    The Process object
+ * @param      path The cgroup directory (such as /sys/fs/cgroup/workers), or
+ *                  NULL to stay in the parent's cgroup
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_set_cgroup(struct Process* p, const char* path) {
+  if (p->cgroup_fd != -1) {
+    close(p->cgroup_fd);
+    p->cgroup_fd = -1;
+  }
+  if (path == NULL) {
+    return 1;
+  }
+#ifdef __linux__
+  p->cgroup_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  return (p->cgroup_fd != -1 ? 1 : 0);
+#else
+  errno = ENOSYS;
+  return 0;
+#endif
+}
+
+/**
+ * @brief Process Set Default Engine
+ *
+ * Selects the launch engine for Process objects using PROCESS_ENGINE_DEFAULT
+ *
+ * @param engine The launch engine (one of PROCESS_ENGINE_*)
+ */
+extern void process_set_default_engine(int engine) {
+  if (engine != PROCESS_ENGINE_DEFAULT) {
+    _PROCESS_STORE(_process_default_engine, engine);
+  }
+}
+
+/**
+ * @brief Process Set Engine
+ *
+ * Selects the launch engine used when opening a Process object
+ *
+ * @remarks
+ * PROCESS_ENGINE_SPAWN and PROCESS_ENGINE_VFORK don't copy the parent, so
+ *   their launch latency doesn't grow with the size of the parent
+ *
+ * @param[out] p      The Process object
+ * @param      engine The launch engine (one of PROCESS_ENGINE_*)
+ */
+extern void process_set_engine(struct Process* p, int engine) {
+  p->engine = engine;
+}
+
+/**
+ * @brief Process Set Environment Variable
+ *
+ * Sets an environment variable of a Process object
+ *
+ * @remarks
+ * A variable that is already set (on the Process or its template) is
+ *   overridden rather than duplicated
+ *
+ * @param[out] p     The Process object
+ * @param      name  The name of the variable
+ * @param      value The value of the variable
+ */
+extern void process_set_env(struct Process* p, const char* name,
+    const char* value) {
+  // Build "name=value" directly in the arena
+  size_t nlen = strlen(name);
+  size_t vlen = strlen(value);
+  char* env = _process_arena_alloc(&p->envp_arena, nlen + vlen + 2);
+  if (env != NULL) {
+    memcpy(env, name, nlen);
+    env[nlen] = '=';
+    memcpy(env + nlen + 1, value, vlen + 1);
+    _process_env_put(&p->envp, &p->envc, &p->envp_cap, &p->env_index, env);
+    p->env_dirty = 1;
+  }
+}
+
+/**
+ * @brief Process Set Environment Template
+ *
+ * Bases a Process object's environment on a shared template
+ *
+ * @remarks
+ *  - The Process holds its own reference to the template
+ *  - Environment variables added to the Process form an overlay that
+ *    overrides template variables with the same name; the template itself
+ *    is never copied or modified
+ *  - Pass NULL to detach the Process from its template
+ *
+ * @param[out] p The Process object
+ * @param[out] t The environment template (or NULL)
+ */
+extern void process_set_env_template(struct Process* p,
+    struct ProcessEnvTemplate* t) {
+  if (t != p->env_template) {
+    process_env_template_retain(t);
+    process_env_template_release(p->env_template);
+    p->env_template = t;
+    p->env_dirty    = 1;
+  }
+}
+
+/**
+ * @brief Process Set Exit Callback
+ *
+ * Sets the callback invoked once the Process object is reaped
+ *
+ * @remarks
+ * The callback runs from whichever call reaps the Process: process_wait,
+ *   process_try_wait, process_close, or process_group_poll for a Process
+ *   watched with PROCESS_WATCH_EXIT
+ *
+ * @param[out] p        The Process object
+ * @param      callback The exit callback (or NULL)
+ * @param      data     User data passed to the callback
+ */
+extern void process_set_exit_callback(struct Process* p,
+    ProcessExitCallback callback, void* data) {
+  p->exit_callback = callback;
+  p->exit_data     = data;
+}
+
+/**
+ * @brief Process Set NUMA Policy
+ *
+ * Selects the NUMA memory policy the Process starts with
+ *
+ * @remarks
+ *  - Applied in the child right before execve with set_mempolicy (Linux
+ *    only); the child exits if the kernel rejects the policy
+ *  - Takes effect at the next launch
+ *
+ * @param[out] p     The Process object
+ * @param      mode  The policy (one of PROCESS_NUMA_*)
+ * @param      nodes The NUMA nodes
+ * @param      n     The number of nodes (0 for PROCESS_NUMA_DEFAULT)
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_set_numa_policy(struct Process* p, int mode,
+    const int nodes[], size_t n) {
+#ifdef __linux__
+  if (mode < PROCESS_NUMA_DEFAULT || mode > PROCESS_NUMA_INTERLEAVE ||
+      (mode != PROCESS_NUMA_DEFAULT && n == 0)) {
+    return 0;
+  }
+  struct ProcessPlacement* pl = _process_placement_get(p);
+  if (pl == NULL) {
+    return 0;
+  }
+  memset(pl->nodes, 0, sizeof(pl->nodes));
+  pl->numa_mode = PROCESS_NUMA_DEFAULT;
+  for (size_t i = 0; i < n; i++) {
+    if (nodes[i] < 0 || nodes[i] >= _PROCESS_PLACE_NODES) {
+      return 0;
+    }
+    pl->nodes[nodes[i] / (8 * sizeof(unsigned long))] |=
+      1UL << (nodes[i] % (8 * sizeof(unsigned long)));
+  }
+  pl->numa_mode = mode;
+  return 1;
+#else
+  (void)p;
+  (void)mode;
+  (void)nodes;
+  (void)n;
+  errno = ENOSYS;
+  return 0;
+#endif
+}
+
+/**
+ * @brief Process Set Option
+ *
+ * Enables or disables an option of a Process object
+ *
+ * @remarks
+ *  - PROCESS_OPTION_NONBLOCK makes the in, out and err fds returned by
+ *    process_open non-blocking so they can be driven by an event loop; the
+ *    child's ends are left blocking
+ *  - PROCESS_OPTION_VMSPLICE makes the stdin feeder vmsplice buffers queued
+ *    with process_feed_iov instead of copying them (see process_feed_iov)
+ *  - PROCESS_OPTION_PTY connects piped stdin and stdout to a pseudo-terminal,
+ *    for children that only flush promptly when attached to a terminal;
+ *    in and out are then both the master, closing in doesn't signal end of
+ *    input (feed a ^D instead), and stderr stays a pipe unless merged
+ *
+ * @param[out] p       The Process object
+ * @param      option  The option (one of PROCESS_OPTION_*)
+ * @param      enabled 1 to enable the option, 0 to disable it
+ */
+extern void process_set_option(struct Process* p, int option, int enabled) {
+  if (enabled) {
+    p->options |= option;
+  }
+  else {
+    p->options &= ~option;
+  }
+}
+
+/**
+ * @brief Process Set Process Group
+ *
+ * Selects the process group a Process joins, instead of starting a session
+ *
+ * @remarks
+ *  - By default (-1) the child calls setsid, becoming the leader of a new
+ *    session and process group; 0 makes it the leader of a new process
+ *    group in the caller's session, and a pgid joins that process group
+ *    (which must be in the caller's session)
+ *  - Applied with setpgid in the child (POSIX_SPAWN_SETPGROUP with
+ *    posix_spawn; the zygote engine falls back to vfork); the launch fails
+ *    if the group can't be joined
+ *  - Only a group leader's process_terminate reaches the whole group
+ *
+ * @param[out] p    The Process object
+ * @param      pgid The process group (0 for a new one, -1 for a new session)
+ */
+extern void process_set_pgid(struct Process* p, pid_t pgid) {
+  p->pgid = (pgid < -1 ? -1 : pgid);
+}
+
+/**
+ * @brief Process Set Pipe Size
+ *
+ * Selects the capacity of the pipe created for one of a Process' streams
+ *
+ * @remarks
+ *  - A larger pipe lets a high-output child (or a large stdin feed) move
+ *    more data per context switch; the kernel rounds the size up to a power
+ *    of two pages and caps unprivileged callers at
+ *    /proc/sys/fs/pipe-max-size
+ *  - Applied with F_SETPIPE_SZ (Linux) to the pipes of later launches;
+ *    ignored elsewhere
+ *
+ * @param[out] p      The Process object
+ * @param      stream The stream (one of PROCESS_STREAM_*)
+ * @param      size   The capacity in bytes (0 for the default)
+ *
+ * @return 1 upon success, 0 upon failure
+ */
+extern int process_set_pipe_size(struct Process* p, int stream, size_t size) {
+  if (stream < PROCESS_STREAM_IN || stream > PROCESS_STREAM_ERR ||
+      size > INT_MAX) {
+    return 0;
+  }
+  p->pipe_size[stream] = (int)size;
+  return 1;
+}
+
+/**
+ * @brief Process Set Resource Limit
  *
- * Frees all elements in the array and the array itself
+ * Sets a resource limit (such as RLIMIT_AS, RLIMIT_NOFILE or RLIMIT_CPU) that
+ *   the Process starts with
  *
  * @remarks
- * The provided array variable is NULLed
+ *  - Applied in the child after setsid, right before execve, so no wrapper
+ *    process is needed; the launch fails if a limit can't be applied
+ *  - Setting the same resource again replaces its limits
+ *
+ * @param[out] p        The Process object
+ * @param      resource The resource (one of RLIMIT_*)
+ * @param      soft     The soft limit (or RLIM_INFINITY)
+ * @param      hard     The hard limit (or RLIM_INFINITY)
  *
- * @param[out] arr The array to clear
+ * @return 1 upon success, 0 upon failure
  */
-void _process_array_clear(char*** arr) {
-  if (arr != NULL) {
-    // Free each element
-    int count = _process_array_count(*arr);
-    for (int i = 0; i < count; i++) {
-      free((*arr)[i]);
-      (*arr)[i] = NULL;
+extern int process_set_rlimit(struct Process* p, int resource, rlim_t soft,
+    rlim_t hard) {
+  struct rlimit limit = { soft, hard };
+  for (size_t i = 0; i < p->rlimit_count; i++) {
+    if (p->rlimits[i].resource == resource) {
+      p->rlimits[i].limit = limit;
+      return 1;
     }
-    // Free array
-    free(*arr);
-    *arr = NULL;
   }
+  if (p->rlimit_count == p->rlimit_cap) {
+    size_t cap = (p->rlimit_cap > 0 ? p->rlimit_cap * 2 : 4);
+    struct ProcessRlimit* rlimits = realloc(p->rlimits,
+      cap * sizeof(*rlimits));
+    if (rlimits == NULL) {
+      return 0;
+    }
+    p->rlimits    = rlimits;
+    p->rlimit_cap = cap;
+  }
+  p->rlimits[p->rlimit_count].resource = resource;
+  p->rlimits[p->rlimit_count].limit    = limit;
+  p->rlimit_count++;
+  return 1;
 }
 
 /**
- * @brief Process Array Push
+ * @brief Process Set Stdio
+ *
+ * Selects how one of a Process' standard streams is wired at launch
+ *
+ * @remarks
+ *  - Only PROCESS_STDIO_PIPE creates a pipe; the parent's fd (in, out or
+ *    err) of every other stream is -1, so fire-and-forget launches skip the
+ *    pipe setup and teardown entirely
+ *  - PROCESS_STDIO_NULL uses one /dev/null fd shared by every launch
+ *  - PROCESS_STDIO_FD duplicates fd onto the stream in the child and leaves
+ *    it open in the parent (open the file to redirect to a file); fd should
+ *    be above 2, use PROCESS_STDIO_INHERIT for the parent's own streams
+ *  - PROCESS_STDIO_MERGE is only valid for stderr
+ *  - Takes effect at the next launch
  *
- * Grows an array by one element and copies an item into the new position
+ * @param[out] p      The Process object
+ * @param      stream The stream (one of PROCESS_STREAM_*)
+ * @param      mode   The wiring (one of PROCESS_STDIO_*)
+ * @param      fd     The fd for PROCESS_STDIO_FD (ignored otherwise)
  *
- * @param[out] arr  The array to append an item
- * @param      item The item to append
+ * @return 1 upon success, 0 upon failure
  */
-void _process_array_push(char*** arr, const char* item) {
-  // Count the variables in arr
-  int arrc = _process_array_count(*arr);
-  // Reallocate storage
-  *arr = realloc(*arr, (arrc + 2) * sizeof(char*));
-  // Copy item to new slot
-  _process_string_copy(&((*arr)[arrc]), item);
-  // NULL the last element
-  (*arr)[arrc + 1] = NULL;
+extern int process_set_stdio(struct Process* p, int stream, int mode, int fd) {
+  if (stream < PROCESS_STREAM_IN || stream > PROCESS_STREAM_ERR ||
+      mode < PROCESS_STDIO_PIPE || mode > PROCESS_STDIO_MERGE ||
+      (mode == PROCESS_STDIO_FD && fd < 0) ||
+      (mode == PROCESS_STDIO_MERGE && stream != PROCESS_STREAM_ERR)) {
+    return 0;
+  }
+  p->stdio[stream]    = mode;
+  p->stdio_fd[stream] = (mode == PROCESS_STDIO_FD ? fd : -1);
+  return 1;
 }
 
 /**
- * @brief Process String Copy
+ * @brief Process Set Trace Hook
  *
- * Copies a string into another location
+ * Sets the hook called as each phase of a launch begins and ends
  *
  * @remarks
- * Allocates new storage for destination
+ *  - Called in the launching thread, for every Process, around creating the
+ *    pipes, merging the environment and spawning the child; keep it cheap
+ *  - Set it before other threads start launching (the hook and its data
+ *    aren't swapped as one)
  *
- * @param[out] dest The destination pointer
- * @param      src  The source string
+ * @param callback The hook (or NULL to stop tracing)
+ * @param data     User data passed to the hook
  */
-void _process_string_copy(char** dest, const char* src) {
-  // Allocate space for src at dest
-  *dest = calloc(strlen(src) + 1, sizeof(char));
-  // Copy src to dest
-  memcpy(*dest, src, strlen(src));
+extern void process_set_trace_hook(ProcessTraceCallback callback,
+    void* data) {
+  _PROCESS_STORE(_process_trace_data, data);
+  _PROCESS_STORE(_process_trace_hook, callback);
 }
 
 /**
- * @brief Process Add Argument
+ * @brief Process Supervisor Add
  *
- * Adds an argument to an existing Process
+ * Supervises a Process, restarting it according to a policy as it exits
  *
- * @param[out] p   The Process object
- * @param      arg The environment variable to append
+ * @remarks
+ *  - A Process that isn't running is started by the next
+ *    process_supervisor_poll
+ *  - The supervisor takes over the Process' exit callback and calls the
+ *    previous one after each exit; set the exit callback before adding the
+ *    Process, and don't free it from that callback
+ *  - The Process' streams may be watched in the supervisor's group
+ *    (including PROCESS_WATCH_EXIT); they are watched again after each
+ *    restart
+ *  - max_restarts limits the restarts per window milliseconds (window 0
+ *    counts over the Process' lifetime, max_restarts 0 allows any number);
+ *    once it is reached the Process is left exited and no longer supervised
+ *  - PROCESS_RESTART_ON_FAILURE counts an exit status that couldn't be
+ *    collected (-1, such as a zygote child outliving the zygote) as a
+ *    failure
+ *  - Adding a Process that is already supervised changes its policy
+ *  - Closing a supervised Process kills it, which counts as an exit; remove
+ *    it from the supervisor first to stop it for good
+ *
+ * @param[out] s            The ProcessSupervisor
+ * @param[out] p            The Process object
+ * @param      policy       The restart policy (one of PROCESS_RESTART_*)
+ * @param      max_restarts The restarts allowed per window (0 for no limit)
+ * @param      window       The length of the window (ms, 0 for ever)
+ *
+ * @return 1 upon success, 0 upon failure
  */
-extern void process_add_arg(struct Process* p, const char* arg) {
-  // Push arg on to p->argv
-  _process_array_push(&p->argv, arg);
+extern int process_supervisor_add(struct ProcessSupervisor* s,
+    struct Process* p, int policy, int max_restarts, int window) {
+  if (policy < PROCESS_RESTART_NEVER || policy > PROCESS_RESTART_ON_FAILURE ||
+      max_restarts < 0 || window < 0) {
+    return 0;
+  }
+  struct ProcessService* svc = p->service;
+  if (svc != NULL && svc->sup != s) {
+    // A Process belongs to one supervisor at a time
+    _process_service_detach(svc);
+    svc = NULL;
+  }
+  int64_t now = _process_now();
+  if (svc == NULL) {
+    // Allocate and initialize a new supervision state
+    svc = calloc(1, sizeof(struct ProcessService));
+    if (svc == NULL) {
+      return 0;
+    }
+    svc->sup           = s;
+    svc->p             = p;
+    svc->window_start  = now;
+    svc->backoff       = s->backoff_min;
+    svc->started       = now;
+    svc->exit_callback = p->exit_callback;
+    svc->exit_data     = p->exit_data;
+    svc->next = s->head;
+    if (s->head != NULL) {
+      s->head->prev = svc;
+    }
+    s->head = svc;
+    p->service       = svc;
+    p->exit_callback = _process_service_exit;
+    p->exit_data     = svc;
+  }
+  svc->policy       = policy;
+  svc->max_restarts = max_restarts;
+  svc->window       = window;
+
+  // Watch for the exit of a running Process, or start it
+  if (p->pid != -1 && !p->exited) {
+    struct ProcessWatch* w = p->watch;
+    int streams = PROCESS_WATCH_EXIT;
+    ProcessEventCallback callback = NULL;
+    void* data = NULL;
+    if (w != NULL && w->group == s->group) {
+      streams |= w->requested;
+      callback = w->callback;
+      data     = w->data;
+    }
+    return process_group_add(s->group, p, streams, callback, data);
+  }
+  if (svc->queued == 0) {
+    _process_service_queue(svc, now);
+  }
+  return 1;
 }
 
 /**
- * @brief Process Add Arguments
+ * @brief Process Supervisor Create
  *
- * Adds arguments to an existing Process
+ * Creates a ProcessSupervisor, which restarts the Process objects it
+ *   supervises from the thread calling process_supervisor_poll
  *
- * @param[out] p   The Process object
- * @param      arg The environment variable to append
+ * @remarks
+ * Exits are reaped through the supervisor's ProcessGroup (with pidfds on
+ *   Linux), and restarts wait in a single timer wheel, so no Process is
+ *   polled for
+ *
+ * @return The ProcessSupervisor, or NULL upon failure
  */
-extern void process_add_args(struct Process* p, char* const args[]) {
-  // Add arguments
-  for (int i = 0; args != NULL && args[i] != NULL; i++) {
-    process_add_arg(p, args[i]);
+extern struct ProcessSupervisor* process_supervisor_create(void) {
+  // Allocate and initialize a new ProcessSupervisor
+  struct ProcessSupervisor* s = malloc(sizeof(struct ProcessSupervisor));
+  if (s == NULL) {
+    return NULL;
   }
+  s->group = process_group_create();
+  s->wheel = calloc(_PROCESS_WHEEL_SLOTS, sizeof(struct ProcessService*));
+  if (s->group == NULL || s->wheel == NULL) {
+    process_group_free(s->group);
+    free(s->wheel);
+    free(s);
+    return NULL;
+  }
+  s->head        = NULL;
+  s->wheel_now   = _process_now();
+  s->timers      = 0;
+  s->due         = NULL;
+  s->batch       = NULL;
+  s->batch_cap   = 0;
+  s->backoff_min = _PROCESS_BACKOFF_MIN;
+  s->backoff_max = _PROCESS_BACKOFF_MAX;
+  s->callback    = NULL;
+  s->data        = NULL;
+  return s;
 }
 
 /**
- * @brief Process Add Environment Variable
+ * @brief Process Supervisor Free
  *
- * Adds an environment variable to an existing Process
+ * Stops supervising every Process and destroys a ProcessSupervisor
  *
- * @param[out] p   The Process object
- * @param      env The environment variable to append
+ * @remarks
+ * The Process objects themselves are left as they are (running or not)
+ *
+ * @param[out] s The ProcessSupervisor
  */
-extern void process_add_env(struct Process* p, const char* env) {
-  // Push env on to p->envp
-  _process_array_push(&p->envp, env);
+extern void process_supervisor_free(struct ProcessSupervisor* s) {
+  if (s != NULL) {
+    while (s->head != NULL) {
+      _process_service_detach(s->head);
+    }
+    process_group_free(s->group);
+    free(s->wheel);
+    free(s->batch);
+    free(s);
+  }
 }
 
 /**
- * @brief Process Add Environment Variables
+ * @brief Process Supervisor Poll
  *
- * Adds environment variables to an existing Process
+ * Reaps the supervised Process objects that exit and launches the restarts
+ *   that are due
  *
- * @param[out] p   The Process object
- * @param      env The environment variable to append
+ * @remarks
+ *  - Waits in process_group_poll on the supervisor's group (dispatching the
+ *    readiness callbacks of the streams watched there), no longer than until
+ *    the next restart is due
+ *  - Every restart due is launched in one process_open_batch, so the pipes
+ *    of the whole batch are created in one pass
+ *  - Launches that fail are retried with the same backoff as exits, and
+ *    count toward the restart limit
+ *  - The supervision callback reports each restart, failed launch and
+ *    Process that won't be restarted; it may remove or free the Process it
+ *    is called for
+ *
+ * @param[out] s       The ProcessSupervisor
+ * @param      timeout The longest time to wait (ms, or -1 for no limit)
+ *
+ * @return The number of Process objects restarted, or -1 upon failure
  */
-extern void process_add_envs(struct Process* p, char* const envs[]) {
-  // Add environment variables
-  for (int i = 0; envs != NULL && envs[i] != NULL; i++) {
-    process_add_env(p, envs[i]);
+extern int process_supervisor_poll(struct ProcessSupervisor* s, int timeout) {
+  if (process_group_poll(s->group, _process_supervisor_timeout(s,
+      timeout)) < 0) {
+    return -1;
+  }
+  _process_supervisor_advance(s, _process_now());
+
+  // Gather the due restarts
+  size_t n = 0;
+  for (struct ProcessService* svc = s->due; svc != NULL; svc = svc->qnext) {
+    n++;
+  }
+  if (n > s->batch_cap) {
+    struct Process** batch = realloc(s->batch, n * sizeof(struct Process*));
+    if (batch != NULL) {
+      s->batch     = batch;
+      s->batch_cap = n;
+    }
+  }
+  if (n > s->batch_cap) {
+    n = s->batch_cap;
+  }
+  for (size_t i = 0; i < n; i++) {
+    struct ProcessService* svc = s->due;
+    struct Process* p = svc->p;
+    _process_service_unqueue(svc);
+
+    // Remember the streams watched in the group, and collect the zombie
+    struct ProcessWatch* w = p->watch;
+    svc->streams  = PROCESS_WATCH_EXIT;
+    svc->callback = NULL;
+    svc->data     = NULL;
+    if (w != NULL && w->group == s->group) {
+      svc->streams |= w->requested;
+      svc->callback = w->callback;
+      svc->data     = w->data;
+    }
+    process_close(p);
+    s->batch[i] = p;
+  }
+
+  // Launch them together
+  process_open_batch(s->batch, n);
+  int64_t now = _process_now();
+  int restarted = 0;
+  for (size_t i = 0; i < n; i++) {
+    struct Process* p = s->batch[i];
+    struct ProcessService* svc = p->service;
+    if (svc == NULL) {
+      continue;
+    }
+    svc->started = now;
+    int event = PROCESS_SUPERVISE_RESTARTED;
+    if (p->pid != -1) {
+      process_group_add(s->group, p, svc->streams, svc->callback, svc->data);
+      restarted++;
+    }
+    else if (_process_service_retry(svc, now)) {
+      event = PROCESS_SUPERVISE_FAILED;
+    }
+    else {
+      _process_service_detach(svc);
+      event = PROCESS_SUPERVISE_STOPPED;
+    }
+    if (s->callback != NULL) {
+      s->callback(p, event, s->data);
+    }
   }
+  return restarted;
 }
 
 /**
- * @brief Process Clear argv
+ * @brief Process Supervisor Remove
  *
- * Clears the Process object's arguments
+ * Stops supervising a Process
  *
  * @remarks
- * Frees all arguments and the argv property
+ * The Process is left as it is (running or not), its exit callback is
+ *   restored and it stops being watched by the supervisor's group
  *
+ * @param[out] s The ProcessSupervisor
  * @param[out] p The Process object
  */
-extern void process_clear_argv(struct Process* p) {
-  // Free arguments
-  _process_array_clear(&p->argv);
-  p->argv = NULL;
+extern void process_supervisor_remove(struct ProcessSupervisor* s,
+    struct Process* p) {
+  if (p->service != NULL && p->service->sup == s) {
+    _process_service_detach(p->service);
+    process_group_remove(s->group, p);
+  }
 }
 
 /**
- * @brief Process Clear envp
+ * @brief Process Supervisor Set Backoff
  *
- * Clears the Process object's environment variables
+ * Sets the delays between the restarts of a ProcessSupervisor's Process
+ *   objects
  *
  * @remarks
- * Frees all environment variables and the envp property
+ * A Process is first restarted after min milliseconds, and the delay doubles
+ *   with each restart up to max; it starts over from min once a launch has
+ *   lasted longer than max (by default 1 ms and 30 s)
  *
- * @param[out] p The Process object
+ * @param[out] s   The ProcessSupervisor
+ * @param      min The delay before a first restart (ms)
+ * @param      max The longest delay between restarts (ms)
  */
-extern void process_clear_envp(struct Process* p) {
-  // Free environment variables
-  _process_array_clear(&p->envp);
-  p->envp = NULL;
+extern void process_supervisor_set_backoff(struct ProcessSupervisor* s,
+    int min, int max) {
+  s->backoff_min = (min > 0 ? min : 0);
+  s->backoff_max = (max > s->backoff_min ? max : s->backoff_min);
 }
 
 /**
- * @brief Process Close
+ * @brief Process Supervisor Set Callback
  *
- * Closes the Process' pipes, kills the process, and reaps its zombie
+ * Sets the callback reporting the restarts of a ProcessSupervisor
+ *
+ * @param[out] s        The ProcessSupervisor
+ * @param      callback The supervision callback (or NULL)
+ * @param      data     User data passed to the callback
+ */
+extern void process_supervisor_set_callback(struct ProcessSupervisor* s,
+    ProcessSuperviseCallback callback, void* data) {
+  s->callback = callback;
+  s->data     = data;
+}
+
+/**
+ * @brief Process Tee Output
+ *
+ * Copies the data available on a Process stream to a pipe and moves it to
+ *   another fd, so it can be forwarded to two destinations
  *
  * @remarks
- * After closing a Process, it can be reused
+ *  - On Linux the data is duplicated with tee and moved with splice, without
+ *    passing through user space; elsewhere a bounce buffer is used
+ *  - Honours PROCESS_OPTION_NONBLOCK on the source stream
  *
- * @param[out] p The Process object
+ * @param p      The Process object
+ * @param stream The stream to forward (PROCESS_STREAM_OUT or _ERR)
+ * @param tee_fd The write end of a pipe receiving a copy of the data
+ * @param dst_fd The destination fd (file, socket, pipe, ...)
+ *
+ * @return The number of bytes moved, 0 at end of stream, or -1 upon failure
  */
-extern void process_close(struct Process* p) {
-  // Close pipes
-  if (p->in != -1) {
-    close(p->in);
-    p->in  = -1;
+extern ssize_t process_tee_output(struct Process* p, int stream, int tee_fd,
+    int dst_fd) {
+  int src_fd = _process_stream_fd(p, stream);
+  if (src_fd == -1 || stream == PROCESS_STREAM_IN) {
+    errno = EBADF;
+    return -1;
   }
-  if (p->out != -1) {
-    close(p->out);
-    p->out = -1;
+
+#ifdef __linux__
+  // Duplicate the pipe's contents, then consume the same amount
+  unsigned int flags = 0;
+  if (p->options & PROCESS_OPTION_NONBLOCK) {
+    flags |= SPLICE_F_NONBLOCK;
   }
-  if (p->err != -1) {
-    close(p->err);
-    p->err = -1;
+  ssize_t copied = tee(src_fd, tee_fd, _PROCESS_FORWARD_CHUNK, flags);
+  if (copied > 0) {
+    ssize_t done = 0;
+    while (done < copied) {
+      ssize_t moved = splice(src_fd, NULL, dst_fd, NULL,
+        (size_t)(copied - done), SPLICE_F_MOVE);
+      if (moved <= 0) {
+        return (done > 0 ? done : -1);
+      }
+      done += moved;
+    }
+    _PROCESS_STAT(bytes_read, (uint64_t)done);
+    return done;
   }
+  if (copied == 0 || (errno != EINVAL && errno != ENOSYS)) {
+    return copied;
+  }
+#endif
 
-  // Kill process
-  if (p->pid != -1) {
-    kill(p->pid, SIGKILL);
-    waitpid(p->pid, NULL, WNOHANG);
-    p->pid = -1;
+  // Bounce the data through a buffer
+  char buf[_PROCESS_FORWARD_BUFFER];
+  ssize_t count = read(src_fd, buf, sizeof(buf));
+  if (count < 0 && errno == EIO && (p->options & PROCESS_OPTION_PTY)) {
+    count = 0;
   }
+  if (count > 0) {
+    _PROCESS_STAT(bytes_read, (uint64_t)count);
+    if (!_process_write_full(tee_fd, buf, (size_t)count) ||
+        !_process_write_full(dst_fd, buf, (size_t)count)) {
+      return -1;
+    }
+  }
+  return count;
 }
 
 /**
- * @brief Process Create
+ * @brief Process Terminate
  *
- * Creates a Process object with a binary, arguments, and environment
+ * Asks a Process object to exit, escalating to SIGKILL after a timeout
  *
  * @remarks
- *  - This function inserts the path as the first argument (standard on linux)
- *  - It is recommended to obtain the envp argument from `int main(...)`
- *  - argv and envp must end with a NULL pointer
+ *  - The signal is sent to the Process' whole process group (created by
+ *    setsid in the child)
+ *  - Returns at once: the escalation happens in process_wait,
+ *    process_try_wait or process_group_poll (for a Process in a group) once
+ *    the deadline passes; watch the Process with PROCESS_WATCH_EXIT to have
+ *    the group reap it
  *
- * @param path The path to the binary
- * @param argv The argument list
- * @param envp The environment variable list
+ * @param[out] p       The Process object
+ * @param      sig     The signal to send first (usually SIGTERM)
+ * @param      timeout The grace period in milliseconds (-1 to never escalate)
  *
- * @return The Process object
+ * @return 1 if the signal was sent, 0 upon failure
  */
-extern struct Process* process_create(const char* path, char* const argv[],
-    char* const envp[]) {
-  // Allocate and initialize a new Process
-  struct Process* p = malloc(sizeof(struct Process));
-  p->path = NULL;
-  p->argv = NULL;
-  p->envp = NULL;
-  p->in   = -1;
-  p->out  = -1;
-  p->err  = -1;
-  p->pid  = -1;
-
-  // Copy the provided path to the Process
-  _process_string_copy(&p->path, path);
-
-  // Add arguments
-  process_add_args(p, argv);
-
-  // Add environment variables
-  process_add_envs(p, envp);
+extern int process_terminate(struct Process* p, int sig, int timeout) {
+  if (!_process_signal(p, sig)) {
+    return 0;
+  }
 
-  return p;
+  // Arm the deadline (and the group's, if it is earlier)
+  p->deadline = (timeout >= 0 ? _process_now() + timeout : 0);
+  struct ProcessGroup* g = (p->watch != NULL ? p->watch->group : NULL);
+  if (g != NULL && p->deadline != 0 &&
+      (g->deadline == 0 || p->deadline < g->deadline)) {
+    g->deadline = p->deadline;
+  }
+  return 1;
 }
 
 /**
- * @brief Process Free
+ * @brief Process Terminate Batch
  *
- * Closes and destroys the Process object
+ * Shuts down many Process objects in parallel with one shared deadline
  *
  * @remarks
- * After freeing a Process, it cannot be reused
+ *  - Signals every Process at once, waits until they have all exited or the
+ *    deadline has passed, then SIGKILLs and reaps the remaining ones
+ *  - Blocks for at most timeout milliseconds (plus the time to reap);
+ *    use process_terminate on each Process to avoid blocking
  *
- * @param[out] p The process object
+ * @param[out] ps      The Process objects
+ * @param      n       The number of Process objects
+ * @param      sig     The signal to send first (usually SIGTERM)
+ * @param      timeout The grace period in milliseconds
+ *
+ * @return The number of Process objects that exited before the deadline
  */
-extern void process_free(struct Process* p) {
-  if (p != NULL) {
-    // // Close the process
-    // process_close(p);
+extern size_t process_terminate_batch(struct Process** ps, size_t n, int sig,
+    int timeout) {
+  int64_t deadline = _process_now() + (timeout > 0 ? timeout : 0);
+  size_t graceful = 0;
+  size_t pending  = 0;
 
-    // Free path
-    if (p->path != NULL) {
-      free(p->path);
-      p->path = NULL;
+  // Signal every Process
+  for (size_t i = 0; i < n; i++) {
+    if (!_process_reap(ps[i], 0)) {
+      _process_signal(ps[i], sig);
+      pending++;
     }
+  }
 
-    // Clear arguments
-    process_clear_argv(p);
-
-    // Clear environment variables
-    process_clear_envp(p);
+#ifdef __linux__
+  struct pollfd* pfds = calloc(n, sizeof(struct pollfd));
+#endif
+  // Reap the Process objects as they exit, until the deadline
+  while (pending > 0) {
+    int64_t left = deadline - _process_now();
+    if (left <= 0) {
+      break;
+    }
+#ifdef __linux__
+    nfds_t count = 0;
+    for (size_t i = 0; pfds != NULL && i < n; i++) {
+      if (!ps[i]->exited && _process_pidfd(ps[i]) != -1) {
+        pfds[count].fd     = ps[i]->pidfd;
+        pfds[count].events = POLLIN;
+        count++;
+      }
+    }
+    if (count == pending) {
+      poll(pfds, count, (int)left);
+    }
+    else {
+      usleep(10000);
+    }
+#else
+    usleep(10000);
+#endif
+    for (size_t i = 0; i < n; i++) {
+      if (!ps[i]->exited && _process_reap(ps[i], 0)) {
+        graceful++;
+        pending--;
+      }
+    }
+  }
+#ifdef __linux__
+  free(pfds);
+#endif
 
-    // Free the process
-    free(p);
+  // Kill and reap the remaining Process objects
+  for (size_t i = 0; pending > 0 && i < n; i++) {
+    if (!ps[i]->exited && ps[i]->pid != -1) {
+      _process_signal(ps[i], SIGKILL);
+      _process_reap(ps[i], 1);
+    }
   }
+  return graceful;
 }
 
 /**
- * @brief Process Open
+ * @brief Process Try Wait
+ *
+ * Reaps the Process object if it has exited, without blocking
  *
- * Launches the given Process object via fork/exec
+ * @remarks
+ *  - The exit status and resource usage are recorded in status and usage
+ *  - A pending process_terminate is escalated once its deadline passes
  *
  * @param[out] p The Process object
  *
- * @return 1 upon success, 0 upon failure
+ * @return 1 if the Process has been reaped, 0 if it is still running
  */
-extern int process_open(struct Process* p) {
-  int retVal = 0;
-  if (p->pid == -1) {
-    // Prepare pipes
-    int ipipe[2], opipe[2], epipe[2];
-    pipe(ipipe);
-    pipe(opipe);
-    pipe(epipe);
-
-    // Fork and exec
-    p->pid = fork();
-    if (p->pid == 0) {
-      // Prepare pipes
-      close(ipipe[1]);
-      close(opipe[0]);
-      close(epipe[0]);
-      dup2(ipipe[0], STDIN_FILENO);
-      dup2(opipe[1], STDOUT_FILENO);
-      dup2(epipe[1], STDERR_FILENO);
-      close(ipipe[0]);
-      close(opipe[1]);
-      close(epipe[1]);
-
-      // Create session and process group
-      setsid();
+extern int process_try_wait(struct Process* p) {
+  _process_escalate(p, _process_now());
+  return _process_reap(p, 0);
+}
+
+/**
+ * @brief Process Unset Environment Variable
+ *
+ * Removes an environment variable from a Process object
+ *
+ * @remarks
+ *  - The last variable is moved into the freed position, so envp isn't
+ *    shifted (the order of envp may change)
+ *  - A variable inherited from the environment template is masked for this
+ *    Process only
+ *
+ * @param[out] p    The Process object
+ * @param      name The name of the variable
+ */
+extern void process_unset_env(struct Process* p, const char* name) {
+  size_t len = strlen(name);
+  struct ProcessEnvSlot* slot = _process_env_index_find(&p->env_index, name,
+    len);
+  int templated = (p->env_template != NULL &&
+    _process_env_index_find(&p->env_template->index, name, len) != NULL);
 
-      // Run command
-      execve(p->path, p->argv, p->envp);
+  if (slot != NULL && slot->index != SIZE_MAX) {
+    // Move the last variable into the freed position
+    size_t index = slot->index;
+    char*  last  = p->envp[p->envc - 1];
+    p->envp[index] = last;
+    p->envc--;
+    p->envp[p->envc] = NULL;
+    char* eq = strchr(last, '=');
+    if (eq != NULL) {
+      struct ProcessEnvSlot* moved = _process_env_index_find(&p->env_index,
+        last, (size_t)(eq - last));
+      if (moved != NULL && moved->index == p->envc) {
+        moved->index = index;
+      }
+    }
 
-      // Exit if something goes wrong
-      _exit(1);
+    // Keep the name masked if the template also sets it
+    if (templated) {
+      slot->index = SIZE_MAX;
     }
     else {
-      // Prepare pipes
-      close(ipipe[0]);
-      close(opipe[1]);
-      close(epipe[1]);
-      p->in  = ipipe[1];
-      p->out = opipe[0];
-      p->err = epipe[0];
+      _process_env_index_remove(&p->env_index, slot);
     }
+    p->env_dirty = 1;
+  }
+  else if (slot == NULL && templated) {
+    // Mask the template variable
+    char* key = _process_arena_alloc(&p->envp_arena, len + 1);
+    if (key != NULL) {
+      memcpy(key, name, len + 1);
+      _process_env_index_insert(&p->env_index, key, len, SIZE_MAX);
+      p->env_dirty = 1;
+    }
+  }
+}
 
-    // Update return value
-    retVal = (p->pid != -1 ? 1 : 0);
+/**
+ * @brief Process Wait
+ *
+ * Waits for the Process object to exit and reaps it
+ *
+ * @remarks
+ *  - The exit status and resource usage are recorded in status and usage
+ *  - A pending process_terminate is escalated once its deadline passes
+ *
+ * @param[out] p The Process object
+ *
+ * @return 1 if the Process has been reaped, 0 upon failure
+ */
+extern int process_wait(struct Process* p) {
+  // Wait for the termination deadline, then escalate
+  while (p->deadline != 0 && !_process_reap(p, 0)) {
+    int64_t left = p->deadline - _process_now();
+    if (left <= 0) {
+      _process_escalate(p, _process_now());
+      break;
+    }
+    _process_wait_exit(p, (int)left);
   }
+  return _process_reap(p, 1);
+}
 
+/**
+ * @brief Process Wait Pipeline
+ *
+ * Waits for every stage of a pipeline to exit and reaps them
+ *
+ * @remarks
+ * Each stage's exit status is recorded in its status; the result is the
+ *   status of the last stage that didn't exit with 0, like a shell's
+ *   pipefail
+ *
+ * @param[out] ps The Process objects (as passed to process_open_pipeline)
+ * @param      n  The number of Process objects
+ *
+ * @return The wait status of the last failed stage, 0 if every stage
+ *   succeeded, or -1 if a stage couldn't be reaped
+ */
+extern int process_wait_pipeline(struct Process** ps, size_t n) {
+  int retVal = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (!process_wait(ps[i])) {
+      retVal = -1;
+    }
+    else if (retVal != -1 && ps[i]->status != 0) {
+      retVal = ps[i]->status;
+    }
+  }
   return retVal;
 }
 
+/**
+ * @brief Process Zygote Start
+ *
+ * Forks the zygote, a helper process that launches PROCESS_ENGINE_ZYGOTE
+ *   Process objects on behalf of the parent
+ *
+ * @remarks
+ *  - Call this early, while the parent is still small: children are forked
+ *    from the zygote's image, so launch latency doesn't grow with the parent
+ *  - The zygote closes every fd it inherits but stdio, so the pipes of
+ *    Process objects already open don't stay open in it
+ *  - Children of the zygote aren't children of the parent: the zygote reaps
+ *    them and reports each exit status back, and if the zygote is stopped
+ *    while some are running, their exit status is lost (-1)
+ *
+ * @return 1 upon success (or if already started), 0 upon failure
+ */
+extern int process_zygote_start(void) {
+  pthread_mutex_lock(&_process_zygote_lock);
+  if (_process_zygote_fd != -1) {
+    pthread_mutex_unlock(&_process_zygote_lock);
+    return 1;
+  }
+
+  // Prepare the socket
+  int fds[2];
+#ifdef SOCK_CLOEXEC
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+    pthread_mutex_unlock(&_process_zygote_lock);
+    return 0;
+  }
+#else
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    pthread_mutex_unlock(&_process_zygote_lock);
+    return 0;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+  // Fork the zygote
+  pid_t pid = fork();
+  if (pid == 0) {
+    // The zygote never execs, so close every fd it inherited (such as
+    //   other Process objects' pipes) but stdio and its socket, moved to 3
+    close(fds[0]);
+    int fd = STDERR_FILENO + 1;
+    if (fds[1] != fd && dup2(fds[1], fd) == -1) {
+      _exit(1);
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    _process_fds_sweep(fd + 1, 1);
+    _process_zygote_main(fd);
+  }
+  close(fds[1]);
+  if (pid == -1) {
+    close(fds[0]);
+    pthread_mutex_unlock(&_process_zygote_lock);
+    return 0;
+  }
+
+  _process_zygote_fd  = fds[0];
+  _process_zygote_pid = pid;
+  pthread_mutex_unlock(&_process_zygote_lock);
+  return 1;
+}
+
+/**
+ * @brief Process Zygote Stop
+ *
+ * Shuts down and reaps the zygote
+ *
+ * @remarks
+ * Processes already launched by the zygote keep running
+ */
+extern void process_zygote_stop(void) {
+  pthread_mutex_lock(&_process_zygote_lock);
+  if (_process_zygote_fd != -1) {
+    // Closing the socket makes the zygote exit
+    close(_process_zygote_fd);
+    _process_zygote_fd = -1;
+    waitpid(_process_zygote_pid, NULL, 0);
+    _process_zygote_pid = -1;
+  }
+  pthread_mutex_unlock(&_process_zygote_lock);
+}
+
 #endif
@@ -12,22 +12,299 @@
 #ifndef _PROCMANAGE_H
 #define _PROCMANAGE_H
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
 #include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#endif
+
+// Launch engines used by process_open
+#define PROCESS_ENGINE_DEFAULT 0 // use the global default engine
+#define PROCESS_ENGINE_FORK    1 // fork/exec (copies the parent's page tables)
+#define PROCESS_ENGINE_SPAWN   2 // posix_spawn with file actions
+#define PROCESS_ENGINE_VFORK   3 // vfork/exec (shares the parent's memory)
+#define PROCESS_ENGINE_ZYGOTE  4 // fork/exec from the zygote helper process
+
+// Options of a Process
+#define PROCESS_OPTION_NONBLOCK    0x1 // parent's pipe ends use O_NONBLOCK
+#define PROCESS_OPTION_INHERIT_FDS 0x2 // child keeps every inheritable fd
+#define PROCESS_OPTION_VMSPLICE    0x4 // process_feed_iov buffers are spliced
+                                       //   into stdin (Linux)
+#define PROCESS_OPTION_PTY         0x8 // piped stdin/stdout share a
+                                       //   pseudo-terminal
+
+// Capture modes of a Process' stdout and stderr
+#define PROCESS_CAPTURE_NONE    0 // the caller reads the pipe itself
+#define PROCESS_CAPTURE_FULL    1 // keep everything in a growable buffer
+#define PROCESS_CAPTURE_RING    2 // keep only the last limit bytes
+#define PROCESS_CAPTURE_DISCARD 3 // connect the stream to /dev/null
+
+// Wiring of a Process' standard streams
+#define PROCESS_STDIO_PIPE    0 // a pipe to the parent (the default)
+#define PROCESS_STDIO_INHERIT 1 // the parent's own stream
+#define PROCESS_STDIO_NULL    2 // /dev/null
+#define PROCESS_STDIO_FD      3 // a given fd (such as an open file)
+#define PROCESS_STDIO_MERGE   4 // stderr only: wherever stdout goes
+
+// NUMA memory policies (the kernel's MPOL_* modes)
+#define PROCESS_NUMA_DEFAULT    0 // the parent's policy
+#define PROCESS_NUMA_PREFERRED  1 // prefer the first node, fall back to others
+#define PROCESS_NUMA_BIND       2 // allocate only on the nodes
+#define PROCESS_NUMA_INTERLEAVE 3 // interleave allocations across the nodes
+
+// Units spread over by process_place_batch
+#define PROCESS_PLACE_CPU  0 // one CPU per Process
+#define PROCESS_PLACE_NODE 1 // one NUMA node (its CPUs and memory) per Process
+
+// Phases of process_open reported to the trace hook
+#define PROCESS_PHASE_PIPES 0 // creating the stdio pipes
+#define PROCESS_PHASE_ENV   1 // merging the environment for execve
+#define PROCESS_PHASE_SPAWN 2 // spawning the child with its engine
+
+// Buckets of the launch latency histogram (bucket i counts launches that took
+//   less than 2^(i+1) microseconds; the last one counts every slower launch)
+#define PROCESS_STATS_BUCKETS 24
+
+// Standard streams of a Process
+#define PROCESS_STREAM_IN  0 // stdin  (written by the parent)
+#define PROCESS_STREAM_OUT 1 // stdout (read by the parent)
+#define PROCESS_STREAM_ERR 2 // stderr (read by the parent)
+
+// Stream masks used when adding a Process to a ProcessGroup
+#define PROCESS_WATCH_IN  (1 << PROCESS_STREAM_IN)
+#define PROCESS_WATCH_OUT (1 << PROCESS_STREAM_OUT)
+#define PROCESS_WATCH_ERR (1 << PROCESS_STREAM_ERR)
+#define PROCESS_WATCH_EXIT 0x8 // reap the Process when it exits
+#define PROCESS_WATCH_DRAIN 0x10 // the group reads stdout/stderr itself
+                                 //   (edge-triggered, see process_group_add)
+
+// Readiness events delivered by a ProcessGroup
+#define PROCESS_EVENT_READ   0x1 // the stream has data to read
+#define PROCESS_EVENT_WRITE  0x2 // the stream can be written
+#define PROCESS_EVENT_HANGUP 0x4 // the other end of the stream was closed
+
+// Restart policies of a supervised Process
+#define PROCESS_RESTART_NEVER      0 // only reaped when it exits
+#define PROCESS_RESTART_ALWAYS     1 // restarted whenever it exits
+#define PROCESS_RESTART_ON_FAILURE 2 // restarted unless it exits with 0
+
+// Events reported by a ProcessSupervisor
+#define PROCESS_SUPERVISE_RESTARTED 0 // the Process was launched again
+#define PROCESS_SUPERVISE_FAILED    1 // a launch failed (retried after backoff)
+#define PROCESS_SUPERVISE_STOPPED   2 // the Process won't be restarted again
+
+struct Process;
+struct ProcessFeed;
+struct ProcessPlacement;
+struct ProcessService;
+struct ProcessSlab;
+struct ProcessWatch;
+
+// Readiness callback (stream is one of PROCESS_STREAM_*, events a mask of
+//   PROCESS_EVENT_*)
+typedef void (*ProcessEventCallback)(struct Process* p, int stream,
+  int events, void* data);
+
+// Data callback of streams drained by a ProcessGroup (the buffers are only
+//   valid until it returns; n is 0 at end of stream)
+typedef void (*ProcessDataCallback)(struct Process* p, int stream,
+  const struct iovec iov[], size_t n, void* data);
+
+// Exit callback (the exit status and rusage are recorded in the Process)
+typedef void (*ProcessExitCallback)(struct Process* p, void* data);
+
+// Completion callback of buffers queued with process_feed_iov (written is 1
+//   once they have all been written to stdin, 0 if they were dropped)
+typedef void (*ProcessFeedCallback)(struct Process* p, void* data,
+  int written);
+
+// Supervision callback (event is one of PROCESS_SUPERVISE_*)
+typedef void (*ProcessSuperviseCallback)(struct Process* p, int event,
+  void* data);
+
+// Trace hook called as each phase (one of PROCESS_PHASE_*) of a launch
+//   begins (end is 0) and ends (end is 1)
+typedef void (*ProcessTraceCallback)(struct Process* p, int phase, int end,
+  void* data);
+
+// Counters of every thread's launches, aggregated by process_get_stats
+struct ProcessStats {
+  uint64_t spawns;     // children launched
+  uint64_t failures;   // launches that failed
+  uint64_t fds_opened; // pipe ends and pidfds opened
+  uint64_t bytes_read; // bytes read by process_capture, _forward_output and
+                       //   _tee_output
+  uint64_t reaped;     // children reaped
+  uint64_t unreaped;   // children launched but not reaped yet (running, or
+                       //   zombies waiting to be reaped)
+  uint64_t latency[PROCESS_STATS_BUCKETS]; // launch latency histogram
+};
+
+// Set of Process objects whose streams are watched from a single thread
+struct ProcessGroup {
+  int                  fd;      // epoll (Linux) or kqueue descriptor
+  struct ProcessWatch* head;    // watched Process objects
+  struct ProcessWatch* garbage; // watches removed during a poll
+  int                  polling; // whether events are being dispatched
+  size_t               sweeps;  // exits watched without pidfd/kqueue support
+  int64_t              deadline; // earliest termination deadline, or 0
+  ProcessDataCallback  drain_callback; // data callback of drained streams
+  void*                drain_data; // user data passed to drain_callback
+  struct ProcessSlab*  slabs;   // free buffers shared by the drained streams
+};
+
+// Pool of warm Process objects launched from the same prototype (may be
+//   shared by many threads)
+struct ProcessPool {
+  pthread_mutex_t  lock;         // serializes the pool's operations
+  struct Process*  proto;        // the Process every worker is copied from
+  struct Process** idle;         // workers waiting to be leased
+  int64_t*         idle_since;   // when each idle worker was released (ms)
+  size_t           idle_count;   // number of idle workers
+  size_t           leased;       // number of workers leased out
+  size_t           min;          // number of workers kept alive
+  size_t           max;          // maximum number of workers
+  int              idle_timeout; // ms before surplus idle workers are evicted
+};
+
+// Restarts Process objects as they exit, from a single thread
+struct ProcessSupervisor {
+  struct ProcessGroup*    group;       // reaps the supervised Process objects
+  struct ProcessService*  head;        // supervised Process objects
+  struct ProcessService** wheel;       // pending restarts, one slot per ms
+  int64_t                 wheel_now;   // time (ms) the wheel has reached
+  size_t                  timers;      // restarts waiting in the wheel
+  struct ProcessService*  due;         // restarts ready to be launched
+  struct Process**        batch;       // restarts launched together
+  size_t                  batch_cap;   // number of entries allocated for batch
+  int                     backoff_min; // delay before a first restart (ms)
+  int                     backoff_max; // longest delay between restarts (ms)
+  ProcessSuperviseCallback callback;   // supervision callback (or NULL)
+  void*                   data;        // user data passed to callback
+};
+
+// Growable string storage (see struct ProcessArenaBlock in procmanage.c)
+struct ProcessArena {
+  struct ProcessArenaBlock* head; // most recently allocated (largest) block
+};
+
+// Hash table slot mapping an environment variable name to its position
+struct ProcessEnvSlot {
+  const char* key;   // the variable's name (not NUL-terminated), or NULL
+  size_t      len;   // length of the name
+  size_t      hash;  // hash of the name
+  size_t      index; // position in envp, or SIZE_MAX if the name is unset
+};
+
+// Open addressing hash table of environment variable names
+struct ProcessEnvIndex {
+  struct ProcessEnvSlot* slots; // the slots (a power of two of them)
+  size_t                 cap;   // number of slots allocated
+  size_t                 count; // number of slots in use
+};
+
+// Immutable, reference counted environment shared by many Process objects
+struct ProcessEnvTemplate {
+  char**                 envp;  // environment variables (terminated with NULL)
+  size_t                 envc;  // number of environment variables in envp
+  struct ProcessArena    arena; // storage for the strings in envp
+  struct ProcessEnvIndex index; // names of the variables in envp
+  size_t                 refs;  // number of references held
+};
+
+// Extra fd passed through to a Process
+struct ProcessFdMap {
+  int fd;       // the parent's fd
+  int child_fd; // the fd number it gets in the child
+};
+
+// Resource limit applied to a Process before it execs
+struct ProcessRlimit {
+  int           resource; // the resource (one of RLIMIT_*)
+  struct rlimit limit;    // the soft and hard limits
+};
+
+// Captured output of one of a Process' streams
+struct ProcessCapture {
+  int    mode;  // capture mode (one of PROCESS_CAPTURE_*)
+  char*  data;  // the captured bytes (a ring of cap bytes in RING mode)
+  size_t start; // offset of the oldest captured byte in data
+  size_t len;   // number of captured bytes
+  size_t cap;   // bytes of storage allocated for data
+  size_t limit; // ring size (RING) or initial capacity (FULL)
+};
 
 struct Process {
-  char*  path; // path to binary
-  char** argv; // argument array (terminated with NULL pointer)
-  char** envp; // environment variables (terminated with NULL pointer)
-  int    in;   // stdin  (from Process perspective)
-  int    out;  // stdout (from Process perspective)
-  int    err;  // stderr (from Process perspective)
-  pid_t  pid;  // pid of Process
+  char*  path;   // path to binary
+  char** argv;   // argument array (terminated with NULL pointer)
+  char** envp;   // environment variables (terminated with NULL pointer)
+  int    in;     // stdin  (from Process perspective)
+  int    out;    // stdout (from Process perspective)
+  int    err;    // stderr (from Process perspective)
+  pid_t  pid;    // pid of Process
+  int    error;  // errno of the last failed launch (0 if it succeeded)
+  int    engine; // launch engine (one of PROCESS_ENGINE_*)
+  int    options; // mask of PROCESS_OPTION_*
+  struct ProcessArena argv_arena; // storage for the strings in argv
+  struct ProcessArena envp_arena; // storage for the strings in envp
+  size_t argc;     // number of arguments in argv
+  size_t argv_cap; // number of pointer slots allocated for argv
+  size_t envc;     // number of environment variables in envp
+  size_t envp_cap; // number of pointer slots allocated for envp
+  struct ProcessEnvTemplate* env_template; // base environment (or NULL)
+  char** env_flat;     // template merged with envp (terminated with NULL)
+  size_t env_flat_cap; // number of pointer slots allocated for env_flat
+  int    env_dirty;    // whether env_flat must be rebuilt before launching
+  struct ProcessEnvIndex env_index; // names of the variables in envp
+  struct ProcessWatch* watch; // registration in a ProcessGroup (or NULL)
+  int    pidfd;  // pidfd of Process (Linux), or -1
+  int    exited; // whether the Process has been reaped
+  int    status; // wait status once reaped (-1 if it couldn't be collected)
+  struct rusage usage; // resource usage once reaped
+  ProcessExitCallback exit_callback; // called once the Process is reaped
+  void*  exit_data; // user data passed to exit_callback
+  int64_t deadline; // monotonic time (ms) to escalate to SIGKILL, or 0
+  struct ProcessCapture capture[3]; // captured output (indexed by stream)
+  int    stdio[3];    // wiring of each stream (one of PROCESS_STDIO_*)
+  int    stdio_fd[3]; // fd of each stream wired with PROCESS_STDIO_FD
+  int    pipe_size[3]; // capacity of each stream's pipe (0 for the default)
+  struct ProcessFdMap* fds; // extra fds passed through to the child
+  size_t fd_count; // number of extra fds in fds
+  size_t fd_cap;   // number of entries allocated for fds
+  struct ProcessRlimit* rlimits; // resource limits applied in the child
+  size_t rlimit_count; // number of resource limits in rlimits
+  size_t rlimit_cap;   // number of entries allocated for rlimits
+  int    cgroup_fd;    // cgroup v2 directory the child starts in, or -1
+  struct ProcessPlacement* placement; // CPU affinity and NUMA policy (or NULL)
+  struct ProcessFeed* feed; // buffers queued for stdin (or NULL)
+  pid_t  pgid; // process group to join instead of a new session (0 for a
+               //   new group led by the child, -1 for setsid)
+  size_t path_cap; // bytes allocated for path
+  struct ProcessService* service; // supervision by a ProcessSupervisor (or
+                                  //   NULL)
+  int    zygote; // whether the zygote launched it (so it isn't a child of
+                 //   the caller)
+  int    exit_fd; // pipe the zygote reports the exit status through, or -1
 };
 
 #endif
@@ -39,12 +316,104 @@ extern void process_add_arg(struct Process* p, const char* arg);
 extern void process_add_args(struct Process* p, char* const args[]);
 extern void process_add_env(struct Process* p, const char* env);
 extern void process_add_envs(struct Process* p, char* const envs[]);
+extern ssize_t process_capture(struct Process* p, int stream);
 extern void process_clear_argv(struct Process* p);
 extern void process_clear_envp(struct Process* p);
+extern void process_clear_fds(struct Process* p);
 extern void process_close(struct Process* p);
 extern struct Process* process_create(const char* path, char* const argv[],
   char* const envp[]);
+extern struct Process* process_create_lookup(const char* name,
+  char* const argv[], char* const envp[], const char* search);
+extern struct ProcessEnvTemplate* process_env_template_create(
+  char* const envs[]);
+extern void process_env_template_release(struct ProcessEnvTemplate* t);
+extern struct ProcessEnvTemplate* process_env_template_retain(
+  struct ProcessEnvTemplate* t);
+extern ssize_t process_feed(struct Process* p, const void* buf, size_t len);
+extern int process_feed_close(struct Process* p);
+extern ssize_t process_feed_flush(struct Process* p);
+extern ssize_t process_feed_iov(struct Process* p, const struct iovec iov[],
+  size_t n, ProcessFeedCallback callback, void* data);
+extern size_t process_feed_pending(struct Process* p);
+extern ssize_t process_forward_output(struct Process* p, int stream,
+  int dst_fd);
 extern void process_free(struct Process* p);
+extern const char* process_get_capture(struct Process* p, int stream,
+  size_t* len);
+extern const char* process_get_env(struct Process* p, const char* name);
+extern void process_get_stats(struct ProcessStats* stats);
+extern int process_group_add(struct ProcessGroup* g, struct Process* p,
+  int streams, ProcessEventCallback callback, void* data);
+extern struct ProcessGroup* process_group_create(void);
+extern void process_group_free(struct ProcessGroup* g);
+extern int process_group_poll(struct ProcessGroup* g, int timeout);
+extern void process_group_remove(struct ProcessGroup* g, struct Process* p);
+extern void process_group_set_drain(struct ProcessGroup* g,
+  ProcessDataCallback callback, void* data);
+extern void process_lookup_clear(void);
 extern int process_open(struct Process* p);
+extern size_t process_open_batch(struct Process** ps, size_t n);
+extern int process_open_pipeline(struct Process** ps, size_t n);
+extern int process_pass_fd(struct Process* p, int fd, int child_fd);
+extern size_t process_place_batch(struct Process** ps, size_t n, int unit);
+extern struct Process* process_pool_acquire(struct ProcessPool* pool);
+extern struct ProcessPool* process_pool_create(const char* path,
+  char* const argv[], char* const envp[], size_t min, size_t max);
+extern size_t process_pool_evict(struct ProcessPool* pool);
+extern void process_pool_free(struct ProcessPool* pool);
+extern void process_pool_release(struct ProcessPool* pool,
+  struct Process* p);
+extern void process_pool_set_idle_timeout(struct ProcessPool* pool,
+  int timeout);
+extern int process_reserve_args(struct Process* p, size_t n);
+extern int process_reserve_envs(struct Process* p, size_t n);
+extern int process_rebind(struct Process* p, const char* path,
+  char* const argv[], char* const envp[]);
+extern void process_reset_stats(void);
+extern int process_set_affinity(struct Process* p, const int cpus[],
+  size_t n);
+extern int process_set_capture(struct Process* p, int stream, int mode,
+  size_t limit);
+extern int process_set_cgroup(struct Process* p, const char* path);
+extern void process_set_default_engine(int engine);
+extern void process_set_engine(struct Process* p, int engine);
+extern void process_set_env(struct Process* p, const char* name,
+  const char* value);
+extern void process_set_env_template(struct Process* p,
+  struct ProcessEnvTemplate* t);
+extern void process_set_exit_callback(struct Process* p,
+  ProcessExitCallback callback, void* data);
+extern int process_set_numa_policy(struct Process* p, int mode,
+  const int nodes[], size_t n);
+extern void process_set_option(struct Process* p, int option, int enabled);
+extern void process_set_pgid(struct Process* p, pid_t pgid);
+extern int process_set_pipe_size(struct Process* p, int stream, size_t size);
+extern int process_set_rlimit(struct Process* p, int resource, rlim_t soft,
+  rlim_t hard);
+extern int process_set_stdio(struct Process* p, int stream, int mode, int fd);
+extern void process_set_trace_hook(ProcessTraceCallback callback, void* data);
+extern int process_supervisor_add(struct ProcessSupervisor* s,
+  struct Process* p, int policy, int max_restarts, int window);
+extern struct ProcessSupervisor* process_supervisor_create(void);
+extern void process_supervisor_free(struct ProcessSupervisor* s);
+extern int process_supervisor_poll(struct ProcessSupervisor* s, int timeout);
+extern void process_supervisor_remove(struct ProcessSupervisor* s,
+  struct Process* p);
+extern void process_supervisor_set_backoff(struct ProcessSupervisor* s,
+  int min, int max);
+extern void process_supervisor_set_callback(struct ProcessSupervisor* s,
+  ProcessSuperviseCallback callback, void* data);
+extern ssize_t process_tee_output(struct Process* p, int stream, int tee_fd,
+  int dst_fd);
+extern int process_terminate(struct Process* p, int sig, int timeout);
+extern size_t process_terminate_batch(struct Process** ps, size_t n, int sig,
+  int timeout);
+extern int process_try_wait(struct Process* p);
+extern void process_unset_env(struct Process* p, const char* name);
+extern int process_wait(struct Process* p);
+extern int process_wait_pipeline(struct Process** ps, size_t n);
+extern int process_zygote_start(void);
+extern void process_zygote_stop(void);
 
 #endif